@@ -0,0 +1,456 @@
+#include <util.h>
+#include <gpiod_frequency_counter.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gpiod.h>
+
+/*
+ * Feeds deterministic synthetic edge streams to the counting engine
+ * and reports accuracy, time to result and CPU cost per edge for each
+ * estimator configuration.
+ */
+
+typedef struct scenario {
+	const char *name;
+	double frequency;
+	double duty_cycle;
+	/* edge timestamp noise, standard deviation relative to the period */
+	double jitter;
+	/* probability of losing an edge */
+	double missing;
+	/* probability of a short pulse inside a half period */
+	double glitch;
+} scenario;
+
+typedef struct config {
+	const char *name;
+	int estimator;
+	/* period buffer size (mean) or time constant in periods (EMA) */
+	size_t size;
+} config;
+
+typedef struct result {
+	double frequency_error;
+	double duty_cycle_error;
+	double settle_time;
+	double ns_per_edge;
+} result;
+
+typedef struct arguments {
+	double tolerance;
+	double max_error;
+	unsigned long waves;
+	unsigned long repeat;
+	unsigned long seed;
+	int csv;
+} arguments;
+
+static const scenario scenarios[] = {
+	{ "sweep 1Hz", 1.0, 0.5, 0.0, 0.0, 0.0 },
+	{ "sweep 10Hz", 10.0, 0.5, 0.0, 0.0, 0.0 },
+	{ "sweep 100Hz", 100.0, 0.5, 0.0, 0.0, 0.0 },
+	{ "sweep 1kHz", 1e3, 0.5, 0.0, 0.0, 0.0 },
+	{ "sweep 10kHz", 1e4, 0.5, 0.0, 0.0, 0.0 },
+	{ "sweep 100kHz", 1e5, 0.5, 0.0, 0.0, 0.0 },
+	{ "duty 1%", 1e3, 0.01, 0.0, 0.0, 0.0 },
+	{ "duty 99%", 1e3, 0.99, 0.0, 0.0, 0.0 },
+	{ "jitter 1%", 1e3, 0.5, 0.01, 0.0, 0.0 },
+	{ "jitter 10%", 1e3, 0.5, 0.1, 0.0, 0.0 },
+	{ "jitter 20%", 1e3, 0.5, 0.2, 0.0, 0.0 },
+	{ "missing 0.1%", 1e3, 0.5, 0.0, 0.001, 0.0 },
+	{ "missing 1%", 1e3, 0.5, 0.0, 0.01, 0.0 },
+	{ "glitch 0.1%", 1e3, 0.5, 0.0, 0.0, 0.001 },
+	{ "glitch 1%", 1e3, 0.5, 0.0, 0.0, 0.01 },
+};
+
+static const config configs[] = {
+	{ "mean 8", GPIOD_FREQUENCY_COUNTER_MEAN, 8 },
+	{ "mean 32", GPIOD_FREQUENCY_COUNTER_MEAN, 32 },
+	{ "mean 128", GPIOD_FREQUENCY_COUNTER_MEAN, 128 },
+	{ "mean 512", GPIOD_FREQUENCY_COUNTER_MEAN, 512 },
+	{ "ema 8T", GPIOD_FREQUENCY_COUNTER_EMA, 8 },
+	{ "ema 32T", GPIOD_FREQUENCY_COUNTER_EMA, 32 },
+	{ "ema 128T", GPIOD_FREQUENCY_COUNTER_EMA, 128 },
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
+
+static uint64_t rng_state;
+
+static uint64_t rng_next() {
+	/* xorshift64* */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double rng_uniform() {
+	return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_normal() {
+	double u = 1.0 - rng_uniform();
+	double v = rng_uniform();
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static void set_event(struct gpiod_line_event *ev, int64_t ts, int value) {
+	ev->ts.tv_sec = ts / 1000000000;
+	ev->ts.tv_nsec = ts % 1000000000;
+	ev->event_type = value
+		? GPIOD_LINE_EVENT_RISING_EDGE
+		: GPIOD_LINE_EVENT_FALLING_EDGE;
+}
+
+/*
+ * Generates edges for the given number of waves starting with a rising
+ * edge at t = 1s. Returns the number of events written; events must
+ * have room for 4 * waves + 4 entries.
+ */
+static size_t generate(
+	const scenario *sc,
+	unsigned long waves,
+	struct gpiod_line_event *events
+) {
+	double period = 1e9 / sc->frequency;
+	double half[2] = {
+		period * (1.0 - sc->duty_cycle),
+		period * sc->duty_cycle
+	};
+	double t = 1e9;
+	int64_t last = 0;
+	size_t n = 0;
+	for (unsigned long i = 0; i < 2 * waves + 1; ++i) {
+		int value = !(i & 1);
+		double ts = t + (sc->jitter ? sc->jitter * period * rng_normal() : 0.0);
+		int64_t ns = llround(ts);
+		if (ns <= last) {
+			ns = last + 1;
+		}
+		if (!(sc->missing && rng_uniform() < sc->missing)) {
+			set_event(&events[n++], ns, value);
+			last = ns;
+		}
+		if (sc->glitch && rng_uniform() < sc->glitch) {
+			/* pulse of 1% of the half period in its middle */
+			double width = 0.01 * half[value];
+			int64_t start = llround(t + 0.5 * half[value]);
+			if (start > last) {
+				set_event(&events[n++], start, !value);
+				set_event(&events[n++], start + llround(width) + 1, value);
+				last = start + llround(width) + 1;
+			}
+		}
+		t += half[value];
+	}
+	return n;
+}
+
+static int counter_init(
+	gpiod_frequency_counter *counter,
+	const scenario *sc,
+	const config *cf
+) {
+	if (cf->estimator == GPIOD_FREQUENCY_COUNTER_EMA) {
+		if (gpiod_frequency_counter_init(counter, NULL, 0, NULL, 0)) {
+			return -1;
+		}
+		return gpiod_frequency_counter_set_ema(
+			counter,
+			cf->size / sc->frequency
+		);
+	}
+	return gpiod_frequency_counter_init(counter, NULL, cf->size, NULL, 0);
+}
+
+static double relative_error(double value, double expected) {
+	return fabs(value - expected) / expected;
+}
+
+static double cpu_time() {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return timespec_to_double(ts);
+}
+
+static int run(
+	const arguments *args,
+	const scenario *sc,
+	const config *cf,
+	const struct gpiod_line_event *events,
+	size_t n,
+	result *res
+) {
+	gpiod_frequency_counter counter;
+	if (counter_init(&counter, sc, cf)) {
+		return -1;
+	}
+
+	/*
+	 * Accuracy: estimate after every edge, as count() would return if
+	 * it stopped there. The result settles at the last edge after which
+	 * the frequency error stays within the tolerance.
+	 */
+	double start = timespec_to_double(events[0].ts);
+	double settle = -1.0;
+	for (size_t i = 0; i < n; ++i) {
+		gpiod_frequency_counter_add_event(&counter, &events[i]);
+		gpiod_frequency_counter_update(&counter);
+		double err = relative_error(
+			gpiod_frequency_counter_get_frequency(&counter),
+			sc->frequency
+		);
+		if (!(err <= args->tolerance)) {
+			settle = -1.0;
+		} else if (settle < 0.0) {
+			settle = timespec_to_double(events[i].ts) - start;
+		}
+	}
+	res->settle_time = settle;
+	res->frequency_error = relative_error(
+		gpiod_frequency_counter_get_frequency(&counter),
+		sc->frequency
+	);
+	res->duty_cycle_error = fabs(
+		gpiod_frequency_counter_get_duty_cycle(&counter) - sc->duty_cycle
+	);
+
+	/*
+	 * Cost: the same stream with update() once per buffer of edges,
+	 * which is how count() drives the engine.
+	 */
+	size_t window = cf->size ? 2 * cf->size : n;
+	double time = cpu_time();
+	for (unsigned long r = 0; r < args->repeat; ++r) {
+		gpiod_frequency_counter_reset(&counter);
+		for (size_t i = 0; i < n; ++i) {
+			gpiod_frequency_counter_add_event(&counter, &events[i]);
+			if ((i + 1) % window == 0) {
+				gpiod_frequency_counter_update(&counter);
+			}
+		}
+		gpiod_frequency_counter_update(&counter);
+	}
+	time = cpu_time() - time;
+	res->ns_per_edge = 1e9 * time / ((double)n * args->repeat);
+
+	gpiod_frequency_counter_destroy(&counter);
+	return 0;
+}
+
+static void print_header(const arguments *args) {
+	if (args->csv) {
+		puts(
+			"scenario,config,frequency_error,duty_cycle_error,"
+			"settle_time,settle_waves,ns_per_edge"
+		);
+	} else {
+		printf(
+			"%-14s %-9s %12s %10s %12s %9s %9s\n",
+			"scenario",
+			"config",
+			"freq err",
+			"duty err",
+			"settle (s)",
+			"waves",
+			"ns/edge"
+		);
+	}
+}
+
+static void print_result(
+	const arguments *args,
+	const scenario *sc,
+	const config *cf,
+	const result *res
+) {
+	double waves = res->settle_time * sc->frequency;
+	if (args->csv) {
+		printf(
+			"%s,%s,%.6e,%.6e,%.6e,%.1f,%.2f\n",
+			sc->name,
+			cf->name,
+			res->frequency_error,
+			res->duty_cycle_error,
+			res->settle_time,
+			res->settle_time < 0.0 ? -1.0 : waves,
+			res->ns_per_edge
+		);
+		return;
+	}
+	printf(
+		"%-14s %-9s %12.3e %10.3e ",
+		sc->name,
+		cf->name,
+		res->frequency_error,
+		res->duty_cycle_error
+	);
+	if (res->settle_time < 0.0) {
+		printf("%12s %9s ", "-", "-");
+	} else {
+		printf("%12.6f %9.1f ", res->settle_time, waves);
+	}
+	printf("%9.2f\n", res->ns_per_edge);
+}
+
+void init_args(struct arguments *args) {
+	args->tolerance = 0.01;
+	args->max_error = INFINITY;
+	args->waves = 4096;
+	args->repeat = 16;
+	args->seed = 1;
+	args->csv = 0;
+}
+
+void print_help(const char *name) {
+	struct arguments args;
+	init_args(&args);
+	fprintf(
+		stderr,
+		"Usage: %s [-h] [-t <tolerance>] [-e <error>] [-n <waves>] [-r <count>] [-s <seed>] [-C]\n"
+		"\n"
+		"Options:\n"
+		"    -h, --help               print this help text and exit\n"
+		"    -t, --tolerance <x>      relative frequency error counted as settled (default: %g)\n"
+		"    -e, --max-error <x>      exit with status 2 if any final frequency error is larger\n"
+		"    -n, --waves <n>          waves per scenario (default: %lu)\n"
+		"    -r, --repeat <n>         timing repetitions (default: %lu)\n"
+		"    -s, --seed <n>           random seed (default: %lu)\n"
+		"    -C, --csv                print results as csv\n",
+		name,
+		args.tolerance,
+		args.waves,
+		args.repeat,
+		args.seed
+	);
+}
+
+int parse_args(int argc, char **argv, struct arguments *args) {
+	int i = 1;
+	const char *arg;
+	init_args(args);
+	while (i < argc) {
+		arg = argv[i];
+		if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+			print_help(argv[0]);
+			return 1;
+		} else if (!strcmp(arg, "-t") || !strcmp(arg, "--tolerance")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			args->tolerance = strtod(arg, NULL);
+			if (args->tolerance <= 0.0) {
+				fprintf(
+					stderr,
+					"Tolerance must be greater than 0 (got %s)\n",
+					arg
+				);
+				return 1;
+			}
+		} else if (!strcmp(arg, "-e") || !strcmp(arg, "--max-error")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			args->max_error = strtod(arg, NULL);
+		} else if (!strcmp(arg, "-n") || !strcmp(arg, "--waves")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			args->waves = strtoul(arg, NULL, 0);
+			if (args->waves < 1) {
+				fprintf(
+					stderr,
+					"Number of waves must be greater than 0 (got %s)\n",
+					arg
+				);
+				return 1;
+			}
+		} else if (!strcmp(arg, "-r") || !strcmp(arg, "--repeat")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			args->repeat = strtoul(arg, NULL, 0);
+			if (args->repeat < 1) {
+				args->repeat = 1;
+			}
+		} else if (!strcmp(arg, "-s") || !strcmp(arg, "--seed")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			args->seed = strtoul(arg, NULL, 0);
+		} else if (!strcmp(arg, "-C") || !strcmp(arg, "--csv")) {
+			++i;
+			args->csv = 1;
+		} else {
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	return 0;
+missing_arg:
+	fprintf(stderr, "Option %s requires an argument\n", arg);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	struct arguments args;
+	struct gpiod_line_event *events = NULL;
+	int status = 0;
+
+	if (parse_args(argc, argv, &args)) {
+		return 1;
+	}
+
+	events = calloc(4 * args.waves + 4, sizeof(*events));
+	if (!events) {
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return 1;
+	}
+
+	print_header(&args);
+	for (size_t i = 0; i < ARRAY_SIZE(scenarios); ++i) {
+		const scenario *sc = &scenarios[i];
+		/* same stream for every configuration of a scenario */
+		rng_state = args.seed * 0x9E3779B97F4A7C15ULL + i + 1;
+		size_t n = generate(sc, args.waves, events);
+		for (size_t j = 0; j < ARRAY_SIZE(configs); ++j) {
+			const config *cf = &configs[j];
+			result res;
+			if (run(&args, sc, cf, events, n, &res)) {
+				fprintf(
+					stderr,
+					"%s / %s: %s\n",
+					sc->name,
+					cf->name,
+					strerror(errno)
+				);
+				status = 1;
+				goto end;
+			}
+			print_result(&args, sc, cf, &res);
+			if (!(res.frequency_error <= args.max_error)) {
+				status = 2;
+			}
+		}
+	}
+
+end:
+	free(events);
+	return status;
+}
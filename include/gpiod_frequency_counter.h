@@ -3,15 +3,86 @@
 
 #include <time.h>
 #include <gpiod.h>
+#include <gpiod_frequency_histogram.h>
+#include <gpiod_frequency_logger.h>
+#include <gpiod_frequency_rt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	GPIOD_FREQUENCY_COUNTER_FREQUENCY = 0,
+	GPIOD_FREQUENCY_COUNTER_PERIOD,
+	GPIOD_FREQUENCY_COUNTER_DUTY_CYCLE,
+	GPIOD_FREQUENCY_COUNTER_QUANTITIES
+};
+
+enum {
+	GPIOD_FREQUENCY_COUNTER_MEAN = 0,
+	GPIOD_FREQUENCY_COUNTER_EMA,
+};
+
+enum {
+	GPIOD_FREQUENCY_COUNTER_ALARM_LOW = -1,
+	GPIOD_FREQUENCY_COUNTER_ALARM_NONE = 0,
+	GPIOD_FREQUENCY_COUNTER_ALARM_HIGH = 1,
+};
+
+struct gpiod_frequency_counter;
+
+typedef void (*gpiod_frequency_counter_alarm_cb)(
+	struct gpiod_frequency_counter *counter,
+	int quantity,
+	int state,
+	double value,
+	void *data
+);
+
+typedef struct gpiod_frequency_counter_stats {
+	size_t count;
+	double mean;
+	double min;
+	double max;
+	double stddev;
+} gpiod_frequency_counter_stats;
+
+typedef struct gpiod_frequency_counter_threshold {
+	double low;
+	double high;
+	double hysteresis;
+	int state;
+} gpiod_frequency_counter_threshold;
+
+typedef struct gpiod_frequency_counter_alarm {
+	unsigned enabled;
+	gpiod_frequency_counter_threshold threshold[
+		GPIOD_FREQUENCY_COUNTER_QUANTITIES
+	];
+	gpiod_frequency_counter_alarm_cb callback;
+	void *data;
+	int fd;
+} gpiod_frequency_counter_alarm;
 
 typedef struct gpiod_frequency_counter {
 	struct gpiod_line *line;
 	size_t period_buf_size;
 	char *name;
 	int flags;
+	int own_storage;
+	int requested;
+	int estimator;
+	double ema_tau;
 	double *period_buf[2];
 	size_t period_buf_offset[2];
 	double period[2];
+	double last_period[2];
+	struct gpiod_line_event last_event;
+	gpiod_frequency_counter_alarm *alarm;
+	gpiod_frequency_histogram *histogram;
+	gpiod_frequency_logger *logger;
+	const gpiod_frequency_rt *rt;
+	gpiod_frequency_latency latency;
 } gpiod_frequency_counter;
 
 int gpiod_frequency_counter_init(
@@ -21,15 +92,43 @@ int gpiod_frequency_counter_init(
 	const char *name,
 	int flags
 );
+int gpiod_frequency_counter_init_with_storage(
+	gpiod_frequency_counter *self,
+	struct gpiod_line *line,
+	size_t buf_size,
+	const char *name,
+	int flags,
+	void *storage,
+	size_t storage_size
+);
+size_t gpiod_frequency_counter_storage_size(size_t buf_size, const char *name);
+size_t gpiod_frequency_counter_storage_stride(
+	size_t buf_size,
+	size_t max_name_len
+);
+size_t gpiod_frequency_counter_arena_size(
+	size_t count,
+	size_t buf_size,
+	size_t max_name_len
+);
 void gpiod_frequency_counter_destroy(gpiod_frequency_counter *self);
 void gpiod_frequency_counter_reset(gpiod_frequency_counter *self);
 
+int gpiod_frequency_counter_request(gpiod_frequency_counter *self);
+void gpiod_frequency_counter_release(gpiod_frequency_counter *self);
+
 int gpiod_frequency_counter_count(
 	gpiod_frequency_counter *self,
 	int waves,
 	const struct timespec *timeout
 );
 
+void gpiod_frequency_counter_add_event(
+	gpiod_frequency_counter *self,
+	const struct gpiod_line_event *ev
+);
+void gpiod_frequency_counter_update(gpiod_frequency_counter *self);
+
 double gpiod_frequency_counter_get_period(gpiod_frequency_counter *self);
 double gpiod_frequency_counter_get_frequency(gpiod_frequency_counter *self);
 
@@ -37,6 +136,61 @@ double gpiod_frequency_counter_get_high_period(gpiod_frequency_counter *self);
 double gpiod_frequency_counter_get_low_period(gpiod_frequency_counter *self);
 double gpiod_frequency_counter_get_duty_cycle(gpiod_frequency_counter *self);
 
+int gpiod_frequency_counter_set_ema(
+	gpiod_frequency_counter *self,
+	double tau
+);
+
+void gpiod_frequency_counter_get_stats(
+	gpiod_frequency_counter *self,
+	int value,
+	gpiod_frequency_counter_stats *stats
+);
+
+int gpiod_frequency_counter_set_threshold(
+	gpiod_frequency_counter *self,
+	int quantity,
+	double low,
+	double high,
+	double hysteresis
+);
+void gpiod_frequency_counter_clear_threshold(
+	gpiod_frequency_counter *self,
+	int quantity
+);
+int gpiod_frequency_counter_set_alarm_callback(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_counter_alarm_cb callback,
+	void *data
+);
+int gpiod_frequency_counter_get_alarm_fd(gpiod_frequency_counter *self);
+int gpiod_frequency_counter_get_alarm_state(
+	gpiod_frequency_counter *self,
+	int quantity
+);
+
+void gpiod_frequency_counter_set_histogram(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_histogram *histogram
+);
+
+void gpiod_frequency_counter_set_logger(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_logger *logger
+);
+
+void gpiod_frequency_counter_set_rt(
+	gpiod_frequency_counter *self,
+	const gpiod_frequency_rt *rt
+);
+const gpiod_frequency_latency *gpiod_frequency_counter_get_latency(
+	gpiod_frequency_counter *self
+);
+
 const char *gpiod_frequency_counter_version_string();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,493 @@
+#ifndef GPIOD_FREQUENCY_COUNTER_HPP_INCLUDED
+#define GPIOD_FREQUENCY_COUNTER_HPP_INCLUDED
+
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <system_error>
+#include <utility>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <gpiod.h>
+#include <gpiod_frequency_counter.h>
+
+namespace gpiod_frequency {
+
+inline std::system_error errno_error(const char *what) {
+	return std::system_error(errno, std::generic_category(), what);
+}
+
+inline std::int64_t to_ns(const timespec &ts) {
+	return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline std::int64_t now_ns() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return to_ns(ts);
+}
+
+/*
+ * Waves counted by count() when none are given and the estimator has
+ * no buffer to fill.
+ */
+constexpr std::size_t DEFAULT_WAVES = 32;
+
+/*
+ * timerfd armed at an absolute CLOCK_MONOTONIC deadline (ns, negative
+ * for none), so waiting on it does not drift across wake-ups.
+ */
+class DeadlineTimer {
+public:
+	explicit DeadlineTimer(std::int64_t deadline) : fd_(-1) {
+		if (deadline < 0) {
+			return;
+		}
+		fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (fd_ < 0) {
+			throw errno_error("timerfd_create");
+		}
+		itimerspec its = {};
+		its.it_value.tv_sec = deadline / 1000000000;
+		its.it_value.tv_nsec = deadline % 1000000000;
+		if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &its, nullptr)) {
+			close(fd_);
+			throw errno_error("timerfd_settime");
+		}
+	}
+	~DeadlineTimer() {
+		if (fd_ >= 0) {
+			close(fd_);
+		}
+	}
+	DeadlineTimer(const DeadlineTimer&) = delete;
+	DeadlineTimer& operator=(const DeadlineTimer&) = delete;
+
+	int fd() const {
+		return fd_;
+	}
+
+private:
+	int fd_;
+};
+
+class Chip {
+public:
+	explicit Chip(const char *descr) : chip_(gpiod_chip_open_lookup(descr)) {
+		if (!chip_) {
+			throw errno_error("gpiod_chip_open_lookup");
+		}
+	}
+	~Chip() {
+		if (chip_) {
+			gpiod_chip_close(chip_);
+		}
+	}
+	Chip(const Chip&) = delete;
+	Chip& operator=(const Chip&) = delete;
+	Chip(Chip &&other) noexcept : chip_(other.chip_) {
+		other.chip_ = nullptr;
+	}
+
+	gpiod_line *line(unsigned offset) const {
+		gpiod_line *res = gpiod_chip_get_line(chip_, offset);
+		if (!res) {
+			throw errno_error("gpiod_chip_get_line");
+		}
+		return res;
+	}
+
+	gpiod_chip *get() const {
+		return chip_;
+	}
+
+private:
+	gpiod_chip *chip_;
+};
+
+/*
+ * Holds a both-edges event request for as long as it lives.
+ */
+class LineRequest {
+public:
+	enum {
+		BATCH_SIZE = 16
+	};
+
+	LineRequest(gpiod_line *line, const char *consumer, int flags = 0)
+		: line_(line) {
+		if (gpiod_line_request_both_edges_events_flags(line, consumer, flags)) {
+			throw errno_error("gpiod_line_request_both_edges_events_flags");
+		}
+		fd_ = gpiod_line_event_get_fd(line);
+		if (fd_ < 0) {
+			gpiod_line_release(line);
+			throw errno_error("gpiod_line_event_get_fd");
+		}
+	}
+	~LineRequest() {
+		if (line_) {
+			gpiod_line_release(line_);
+		}
+	}
+	LineRequest(const LineRequest&) = delete;
+	LineRequest& operator=(const LineRequest&) = delete;
+	LineRequest(LineRequest &&other) noexcept
+		: line_(other.line_), fd_(other.fd_) {
+		other.line_ = nullptr;
+	}
+
+	int fd() const {
+		return fd_;
+	}
+
+	/*
+	 * Waits until events are available or the deadline timer expires.
+	 * Returns false on timeout.
+	 */
+	bool wait(const DeadlineTimer &deadline) const {
+		pollfd fds[2] = {
+			{ fd_, POLLIN | POLLPRI, 0 },
+			{ deadline.fd(), POLLIN, 0 },
+		};
+		while (poll(fds, 2, -1) < 0) {
+			if (errno != EINTR) {
+				throw errno_error("poll");
+			}
+		}
+		return fds[0].revents != 0;
+	}
+
+	template<class F>
+	int read(F &&f) const {
+		gpiod_line_event events[BATCH_SIZE];
+		int rc = gpiod_line_event_read_fd_multiple(fd_, events, BATCH_SIZE);
+		if (rc < 0) {
+			throw errno_error("gpiod_line_event_read_fd_multiple");
+		}
+		for (int i = 0; i < rc; ++i) {
+			f(events[i]);
+		}
+		return rc;
+	}
+
+private:
+	gpiod_line *line_;
+	int fd_;
+};
+
+/*
+ * Mean of the last N low and high periods. N must be a power of two.
+ */
+template<std::size_t N>
+class MeanEstimator {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+	MeanEstimator() {
+		reset();
+	}
+
+	void start() {}
+
+	void add(int value, double period) {
+		std::size_t &offset = offset_[value];
+		sum_[value] += period - buf_[value][offset];
+		buf_[value][offset] = period;
+		offset = (offset + 1) & (N - 1);
+		if (count_[value] < N) {
+			++count_[value];
+		}
+		if (!offset) {
+			/* Recompute the running sum once per ring to bound rounding drift */
+			double sum = 0.0;
+			for (double p : buf_[value]) {
+				sum += p;
+			}
+			sum_[value] = sum;
+		}
+	}
+
+	double half_period(int value) const {
+		if (!count_[value]) {
+			return std::numeric_limits<double>::infinity();
+		}
+		return sum_[value] / count_[value];
+	}
+
+	void reset() {
+		for (int i = 0; i < 2; ++i) {
+			buf_[i].fill(0.0);
+			offset_[i] = 0;
+			count_[i] = 0;
+			sum_[i] = 0.0;
+		}
+	}
+
+	static constexpr std::size_t buf_size() {
+		return N;
+	}
+
+private:
+	std::array<double, N> buf_[2];
+	std::size_t offset_[2];
+	std::size_t count_[2];
+	double sum_[2];
+};
+
+/*
+ * Exponential moving average with time constant tau in seconds of
+ * signal time, at any duty cycle.
+ */
+class EmaEstimator {
+public:
+	explicit EmaEstimator(double tau = 0.1) : tau_(tau) {
+		reset();
+	}
+
+	void start() {}
+
+	void add(int value, double period) {
+		double &prev = period_[value];
+		double other = period_[!value];
+		if (std::isinf(prev)) {
+			prev = period;
+		} else {
+			/*
+			 * Each half is updated once per wave, so dt is the estimated
+			 * full period; the sample would bias the estimate low.
+			 */
+			double dt = std::isinf(other) ? prev : prev + other;
+			prev += dt / (tau_ + dt) * (period - prev);
+		}
+	}
+
+	double half_period(int value) const {
+		return period_[value];
+	}
+
+	void reset() {
+		period_[0] = period_[1] = std::numeric_limits<double>::infinity();
+	}
+
+	static constexpr std::size_t buf_size() {
+		return DEFAULT_WAVES;
+	}
+
+private:
+	double tau_;
+	double period_[2];
+};
+
+/*
+ * Total low and high time over the gate (one count() call) divided by
+ * the number of waves in it.
+ */
+class GateTimeEstimator {
+public:
+	GateTimeEstimator() {
+		reset();
+	}
+
+	void start() {
+		reset();
+	}
+
+	void add(int value, double period) {
+		sum_[value] += period;
+		++count_[value];
+	}
+
+	double half_period(int value) const {
+		if (!count_[value]) {
+			return std::numeric_limits<double>::infinity();
+		}
+		return sum_[value] / count_[value];
+	}
+
+	void reset() {
+		sum_[0] = sum_[1] = 0.0;
+		count_[0] = count_[1] = 0;
+	}
+
+	static constexpr std::size_t buf_size() {
+		return DEFAULT_WAVES;
+	}
+
+private:
+	double sum_[2];
+	std::uint64_t count_[2];
+};
+
+/*
+ * Frequency counter with the estimator selected at compile time.
+ * The per-edge path is inline and does not allocate.
+ */
+template<class Estimator>
+class BasicFrequencyCounter {
+public:
+	explicit BasicFrequencyCounter(
+		gpiod_line *line,
+		const char *name = "gpiod_frequency_counter",
+		int flags = 0,
+		Estimator estimator = Estimator()
+	)
+		: line_(line), name_(name), flags_(flags), estimator_(estimator),
+		  last_ts_(0), last_value_(0) {}
+
+	/*
+	 * Returns false if the timeout (ns, negative for none) expired
+	 * before the given number of waves was counted.
+	 */
+	bool count(int waves = 0, std::int64_t timeout = -1) {
+		LineRequest request(line_, name_, flags_);
+		std::int64_t start = now_ns();
+		DeadlineTimer deadline(timeout >= 0 ? start + timeout : -1);
+		if (waves == 0) {
+			waves = int(Estimator::buf_size());
+		}
+		int events = waves * 2;
+		last_ts_ = 0;
+		estimator_.start();
+		while (events > 0) {
+			if (!request.wait(deadline)) {
+				return false;
+			}
+			request.read([&](const gpiod_line_event &ev) {
+				/* the rest of the batch is past the window */
+				if (events > 0 && to_ns(ev.ts) > start && add_event(ev)) {
+					--events;
+				}
+			});
+		}
+		return true;
+	}
+
+	bool add_event(const gpiod_line_event &ev) {
+		std::int64_t ts = to_ns(ev.ts);
+		bool res = last_ts_ != 0;
+		if (res) {
+			estimator_.add(last_value_, 1e-9 * double(ts - last_ts_));
+		}
+		last_ts_ = ts;
+		last_value_ = ev.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+		return res;
+	}
+
+	void reset() {
+		estimator_.reset();
+		last_ts_ = 0;
+	}
+
+	double low_period() const {
+		return estimator_.half_period(0);
+	}
+
+	double high_period() const {
+		return estimator_.half_period(1);
+	}
+
+	double period() const {
+		return low_period() + high_period();
+	}
+
+	double frequency() const {
+		double p = period();
+		if (std::isinf(p)) {
+			return 0.0;
+		}
+		if (p == 0.0) {
+			return std::numeric_limits<double>::infinity();
+		}
+		return 1.0 / p;
+	}
+
+	double duty_cycle() const {
+		double p = period();
+		if (p == 0.0 || std::isinf(p)) {
+			return 1.0;
+		}
+		return high_period() / p;
+	}
+
+	Estimator &estimator() {
+		return estimator_;
+	}
+
+private:
+	gpiod_line *line_;
+	const char *name_;
+	int flags_;
+	Estimator estimator_;
+	std::int64_t last_ts_;
+	int last_value_;
+};
+
+/*
+ * RAII wrapper around the C gpiod_frequency_counter.
+ */
+class FrequencyCounter {
+public:
+	FrequencyCounter(
+		gpiod_line *line,
+		std::size_t buf_size,
+		const char *name = nullptr,
+		int flags = 0
+	) {
+		if (gpiod_frequency_counter_init(&counter_, line, buf_size, name, flags)) {
+			throw errno_error("gpiod_frequency_counter_init");
+		}
+	}
+	~FrequencyCounter() {
+		gpiod_frequency_counter_destroy(&counter_);
+	}
+	FrequencyCounter(const FrequencyCounter&) = delete;
+	FrequencyCounter& operator=(const FrequencyCounter&) = delete;
+
+	void count(int waves = 0, const timespec *timeout = nullptr) {
+		if (gpiod_frequency_counter_count(&counter_, waves, timeout)) {
+			throw errno_error("gpiod_frequency_counter_count");
+		}
+	}
+
+	void reset() {
+		gpiod_frequency_counter_reset(&counter_);
+	}
+
+	double period() {
+		return gpiod_frequency_counter_get_period(&counter_);
+	}
+
+	double frequency() {
+		return gpiod_frequency_counter_get_frequency(&counter_);
+	}
+
+	double high_period() {
+		return gpiod_frequency_counter_get_high_period(&counter_);
+	}
+
+	double low_period() {
+		return gpiod_frequency_counter_get_low_period(&counter_);
+	}
+
+	double duty_cycle() {
+		return gpiod_frequency_counter_get_duty_cycle(&counter_);
+	}
+
+	gpiod_frequency_counter *get() {
+		return &counter_;
+	}
+
+private:
+	gpiod_frequency_counter counter_;
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef GPIOD_FREQUENCY_COUNTER_POOL_H_INCLUDED
+#define GPIOD_FREQUENCY_COUNTER_POOL_H_INCLUDED
+
+#include <stdint.h>
+#include <time.h>
+#include <gpiod.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pollfd;
+
+typedef struct gpiod_frequency_counter_pool {
+	size_t size;
+	size_t period_buf_size;
+	char *name;
+	int flags;
+	int requested;
+	struct gpiod_line **lines;
+	int64_t *last_ts;
+	uint8_t *last_value;
+	uint32_t *period_buf_offset;
+	uint32_t *period_buf_count;
+	double *period_sum;
+	double *period_buf;
+	int *pending;
+	struct pollfd *fds;
+	void *storage;
+} gpiod_frequency_counter_pool;
+
+int gpiod_frequency_counter_pool_init(
+	gpiod_frequency_counter_pool *self,
+	struct gpiod_line **lines,
+	size_t size,
+	size_t buf_size,
+	const char *name,
+	int flags
+);
+void gpiod_frequency_counter_pool_destroy(gpiod_frequency_counter_pool *self);
+void gpiod_frequency_counter_pool_reset(gpiod_frequency_counter_pool *self);
+void gpiod_frequency_counter_pool_reset_line(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+
+int gpiod_frequency_counter_pool_request(gpiod_frequency_counter_pool *self);
+void gpiod_frequency_counter_pool_release(gpiod_frequency_counter_pool *self);
+
+void gpiod_frequency_counter_pool_add_events(
+	gpiod_frequency_counter_pool *self,
+	size_t index,
+	const struct gpiod_line_event *events,
+	size_t count
+);
+int gpiod_frequency_counter_pool_count(
+	gpiod_frequency_counter_pool *self,
+	int waves,
+	const struct timespec *timeout
+);
+
+double gpiod_frequency_counter_pool_get_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+double gpiod_frequency_counter_pool_get_frequency(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+double gpiod_frequency_counter_pool_get_high_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+double gpiod_frequency_counter_pool_get_low_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+double gpiod_frequency_counter_pool_get_duty_cycle(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
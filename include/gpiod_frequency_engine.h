@@ -0,0 +1,91 @@
+#ifndef GPIOD_FREQUENCY_ENGINE_H_INCLUDED
+#define GPIOD_FREQUENCY_ENGINE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <gpiod.h>
+#include <gpiod_frequency_counter_pool.h>
+#include <gpiod_frequency_rt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gpiod_frequency_engine_result {
+	double frequency;
+	double period;
+	double duty_cycle;
+	uint64_t edges;
+	int64_t last_ts;
+} gpiod_frequency_engine_result;
+
+typedef struct gpiod_frequency_shard {
+	uint32_t seq;
+	gpiod_frequency_engine_result *results __attribute__((aligned(64)));
+	gpiod_frequency_counter_pool pool;
+	size_t *index;
+	struct pollfd *fds;
+	int stop_fd;
+	int running;
+	int error;
+	size_t id;
+	int64_t timeout;
+	const gpiod_frequency_rt *rt;
+	pthread_t thread;
+} __attribute__((aligned(64))) gpiod_frequency_shard;
+
+typedef struct gpiod_frequency_engine {
+	size_t size;
+	size_t shard_count;
+	gpiod_frequency_shard *shards;
+	size_t *shard_of;
+	size_t *local_of;
+	int stop_fd;
+	int running;
+	int64_t timeout;
+	const gpiod_frequency_rt *rt;
+} gpiod_frequency_engine;
+
+int gpiod_frequency_engine_init(
+	gpiod_frequency_engine *self,
+	struct gpiod_line **lines,
+	size_t size,
+	size_t threads,
+	size_t buf_size,
+	const char *name,
+	int flags
+);
+void gpiod_frequency_engine_destroy(gpiod_frequency_engine *self);
+
+void gpiod_frequency_engine_set_rt(
+	gpiod_frequency_engine *self,
+	const gpiod_frequency_rt *rt
+);
+int gpiod_frequency_engine_set_timeout(
+	gpiod_frequency_engine *self,
+	double timeout
+);
+int gpiod_frequency_engine_start(gpiod_frequency_engine *self);
+int gpiod_frequency_engine_stop(gpiod_frequency_engine *self);
+
+size_t gpiod_frequency_engine_get_shard(
+	gpiod_frequency_engine *self,
+	size_t index
+);
+void gpiod_frequency_engine_get_result(
+	gpiod_frequency_engine *self,
+	size_t index,
+	gpiod_frequency_engine_result *res
+);
+void gpiod_frequency_engine_get_results(
+	gpiod_frequency_engine *self,
+	gpiod_frequency_engine_result *res
+);
+int gpiod_frequency_engine_get_error(gpiod_frequency_engine *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef GPIOD_FREQUENCY_HISTOGRAM_H_INCLUDED
+#define GPIOD_FREQUENCY_HISTOGRAM_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log-linear period histogram in nanoseconds: values below 2^SUB_BITS
+ * get one bin each, every following power of two is split into
+ * 2^SUB_BITS bins. Values from 2^(MAX_EXP+1) ns (~137 s) on go to the
+ * last bin.
+ */
+#define GPIOD_FREQUENCY_HISTOGRAM_SUB_BITS 4
+#define GPIOD_FREQUENCY_HISTOGRAM_MAX_EXP 36
+#define GPIOD_FREQUENCY_HISTOGRAM_BINS ( \
+	(GPIOD_FREQUENCY_HISTOGRAM_MAX_EXP - GPIOD_FREQUENCY_HISTOGRAM_SUB_BITS + 2) \
+	<< GPIOD_FREQUENCY_HISTOGRAM_SUB_BITS \
+)
+
+typedef struct gpiod_frequency_histogram {
+	uint64_t count;
+	uint64_t bins[GPIOD_FREQUENCY_HISTOGRAM_BINS];
+} gpiod_frequency_histogram;
+
+static inline size_t gpiod_frequency_histogram_index(uint64_t ns) {
+	const int sub_bits = GPIOD_FREQUENCY_HISTOGRAM_SUB_BITS;
+	if (ns < (1u << sub_bits)) {
+		return ns;
+	}
+	int exp = 63 - __builtin_clzll(ns);
+	if (exp > GPIOD_FREQUENCY_HISTOGRAM_MAX_EXP) {
+		return GPIOD_FREQUENCY_HISTOGRAM_BINS - 1;
+	}
+	size_t sub = (ns >> (exp - sub_bits)) & ((1u << sub_bits) - 1);
+	return ((size_t)(exp - sub_bits + 1) << sub_bits) + sub;
+}
+
+static inline void gpiod_frequency_histogram_add(
+	gpiod_frequency_histogram *self,
+	uint64_t ns
+) {
+	++self->bins[gpiod_frequency_histogram_index(ns)];
+	++self->count;
+}
+
+void gpiod_frequency_histogram_reset(gpiod_frequency_histogram *self);
+void gpiod_frequency_histogram_merge(
+	gpiod_frequency_histogram *self,
+	const gpiod_frequency_histogram *other
+);
+
+uint64_t gpiod_frequency_histogram_get_bin_lower(size_t index);
+uint64_t gpiod_frequency_histogram_get_bin_upper(size_t index);
+double gpiod_frequency_histogram_get_percentile(
+	const gpiod_frequency_histogram *self,
+	double percentile
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef GPIOD_FREQUENCY_LOGGER_H_INCLUDED
+#define GPIOD_FREQUENCY_LOGGER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <gpiod.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIOD_FREQUENCY_LOG_MAGIC 0x4c465047 /* "GPFL" */
+#define GPIOD_FREQUENCY_LOG_VERSION 2
+
+/*
+ * Record index of a session marker. Appending to a log starts a session
+ * with a marker whose start field is the CLOCK_REALTIME - CLOCK_MONOTONIC
+ * offset for the records following it, since the monotonic clock
+ * restarts on reboot. Ring logs are rewritten per session and use the
+ * offset in the header.
+ */
+#define GPIOD_FREQUENCY_LOG_SESSION UINT32_MAX
+
+enum {
+	GPIOD_FREQUENCY_RECORD_MEAN,
+	GPIOD_FREQUENCY_RECORD_MIN,
+	GPIOD_FREQUENCY_RECORD_MAX,
+	GPIOD_FREQUENCY_RECORD_STDDEV,
+	GPIOD_FREQUENCY_RECORD_STATS
+};
+
+typedef struct gpiod_frequency_log_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+	int64_t interval;
+	int64_t realtime_offset;
+	uint32_t max_records;
+	uint32_t reserved;
+} gpiod_frequency_log_header;
+
+typedef struct gpiod_frequency_record {
+	int64_t start;
+	uint32_t index;
+	uint32_t edges;
+	float frequency[GPIOD_FREQUENCY_RECORD_STATS];
+	float duty_cycle[GPIOD_FREQUENCY_RECORD_STATS];
+} gpiod_frequency_record;
+
+typedef struct gpiod_frequency_logger {
+	int64_t interval;
+	uint32_t index;
+	int64_t start;
+	uint32_t edges;
+	uint32_t waves;
+	double frequency_sum;
+	double frequency_sum_sq;
+	double frequency_min;
+	double frequency_max;
+	double duty_cycle_sum;
+	double duty_cycle_sum_sq;
+	double duty_cycle_min;
+	double duty_cycle_max;
+	int64_t last_rise;
+	int64_t last_fall;
+	gpiod_frequency_record *ring;
+	size_t ring_size;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t dropped;
+	uint64_t written;
+	size_t max_records;
+	int fd;
+	int wake_fd;
+	int stop;
+	int error;
+	int running;
+	pthread_t thread;
+} gpiod_frequency_logger;
+
+int gpiod_frequency_logger_init(
+	gpiod_frequency_logger *self,
+	const char *path,
+	double interval,
+	size_t ring_size,
+	size_t max_records,
+	uint32_t index
+);
+void gpiod_frequency_logger_destroy(gpiod_frequency_logger *self);
+
+void gpiod_frequency_logger_add_event(
+	gpiod_frequency_logger *self,
+	const struct gpiod_line_event *ev
+);
+void gpiod_frequency_logger_break(gpiod_frequency_logger *self);
+void gpiod_frequency_logger_flush(
+	gpiod_frequency_logger *self,
+	const struct timespec *now
+);
+
+uint64_t gpiod_frequency_logger_get_written(gpiod_frequency_logger *self);
+uint64_t gpiod_frequency_logger_get_dropped(gpiod_frequency_logger *self);
+int gpiod_frequency_logger_get_error(gpiod_frequency_logger *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef GPIOD_FREQUENCY_PHASE_H_INCLUDED
+#define GPIOD_FREQUENCY_PHASE_H_INCLUDED
+
+#include <gpiod_frequency_counter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gpiod_frequency_phase {
+	gpiod_frequency_counter counter[2];
+	size_t phase_buf_size;
+	double *phase_buf;
+	size_t phase_buf_offset;
+	double skew;
+	struct timespec last_rising;
+	int has_rising;
+} gpiod_frequency_phase;
+
+int gpiod_frequency_phase_init(
+	gpiod_frequency_phase *self,
+	struct gpiod_line *reference,
+	struct gpiod_line *line,
+	size_t buf_size,
+	const char *name,
+	int flags
+);
+void gpiod_frequency_phase_destroy(gpiod_frequency_phase *self);
+void gpiod_frequency_phase_reset(gpiod_frequency_phase *self);
+
+void gpiod_frequency_phase_add_event(
+	gpiod_frequency_phase *self,
+	int index,
+	const struct gpiod_line_event *ev
+);
+void gpiod_frequency_phase_update(gpiod_frequency_phase *self);
+
+int gpiod_frequency_phase_count(
+	gpiod_frequency_phase *self,
+	int waves,
+	const struct timespec *timeout
+);
+
+gpiod_frequency_counter *gpiod_frequency_phase_get_counter(
+	gpiod_frequency_phase *self,
+	int index
+);
+double gpiod_frequency_phase_get_skew(gpiod_frequency_phase *self);
+double gpiod_frequency_phase_get_phase(gpiod_frequency_phase *self);
+double gpiod_frequency_phase_get_frequency_ratio(gpiod_frequency_phase *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef GPIOD_FREQUENCY_RT_H_INCLUDED
+#define GPIOD_FREQUENCY_RT_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gpiod_frequency_rt {
+	int policy;
+	int priority;
+	int cpu;
+	int lock_memory;
+	size_t prefault_stack;
+} gpiod_frequency_rt;
+
+typedef struct gpiod_frequency_latency {
+	uint64_t wakeups;
+	uint64_t sum_ns;
+	uint64_t max_ns;
+} gpiod_frequency_latency;
+
+void gpiod_frequency_rt_init(gpiod_frequency_rt *self);
+int gpiod_frequency_rt_apply(const gpiod_frequency_rt *self);
+
+void gpiod_frequency_latency_reset(gpiod_frequency_latency *self);
+double gpiod_frequency_latency_get_mean(const gpiod_frequency_latency *self);
+double gpiod_frequency_latency_get_max(const gpiod_frequency_latency *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
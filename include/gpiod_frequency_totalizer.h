@@ -0,0 +1,65 @@
+#ifndef GPIOD_FREQUENCY_TOTALIZER_H_INCLUDED
+#define GPIOD_FREQUENCY_TOTALIZER_H_INCLUDED
+
+#include <stdint.h>
+#include <pthread.h>
+#include <gpiod.h>
+#include <gpiod_frequency_rt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	GPIOD_FREQUENCY_TOTALIZER_RISING_EDGE = 1,
+	GPIOD_FREQUENCY_TOTALIZER_FALLING_EDGE = 2,
+	GPIOD_FREQUENCY_TOTALIZER_BOTH_EDGES = 3,
+};
+
+typedef struct gpiod_frequency_totalizer {
+	struct gpiod_line *line;
+	char *name;
+	int flags;
+	int edges;
+	int running;
+	int error;
+	int stop_fd;
+	pthread_t thread;
+	uint32_t seq;
+	uint64_t count;
+	int64_t last_ts;
+	uint64_t rate_count;
+	int64_t rate_ts;
+	const gpiod_frequency_rt *rt;
+	gpiod_frequency_latency latency;
+} gpiod_frequency_totalizer;
+
+int gpiod_frequency_totalizer_init(
+	gpiod_frequency_totalizer *self,
+	struct gpiod_line *line,
+	int edges,
+	const char *name,
+	int flags
+);
+void gpiod_frequency_totalizer_destroy(gpiod_frequency_totalizer *self);
+
+void gpiod_frequency_totalizer_set_rt(
+	gpiod_frequency_totalizer *self,
+	const gpiod_frequency_rt *rt
+);
+int gpiod_frequency_totalizer_start(gpiod_frequency_totalizer *self);
+int gpiod_frequency_totalizer_stop(gpiod_frequency_totalizer *self);
+
+uint64_t gpiod_frequency_totalizer_get_count(gpiod_frequency_totalizer *self);
+double gpiod_frequency_totalizer_get_rate(gpiod_frequency_totalizer *self);
+int gpiod_frequency_totalizer_get_error(gpiod_frequency_totalizer *self);
+void gpiod_frequency_totalizer_get_latency(
+	gpiod_frequency_totalizer *self,
+	gpiod_frequency_latency *latency
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,8 +4,10 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <time.h>
 #include <gpiod.h>
+#include <gpiod_frequency_rt.h>
 
 #define EXPORT __attribute__((visibility("default")))
 
@@ -16,6 +18,7 @@
 #endif
 
 #define timespec_to_double(ts) ((double)(ts).tv_sec + (1e-9 * (ts).tv_nsec))
+#define timespec_to_ns(ts) ((int64_t)(ts).tv_sec * 1000000000 + (ts).tv_nsec)
 
 #define dbg_timespec(msg, ts) dbg(msg ": %.04lfs\n", timespec_to_double(ts))
 #define dbg_event(msg, ev) dbg(msg ": %d %.04lfs\n", (ev).event_type == GPIOD_LINE_EVENT_RISING_EDGE, timespec_to_double((ev).ts))
@@ -39,18 +42,65 @@ int timespec_ge(
 	const struct timespec *x,
 	const struct timespec *y
 );
-int update_timeout(
+void timespec_add(
+	const struct timespec *x,
+	const struct timespec *y,
+	struct timespec *res
+);
+
+int deadline_timer_create(
 	const struct timespec *start,
-	const struct timespec *timeout,
-	struct timespec *remaining
+	const struct timespec *timeout
 );
 
-int read_event(
+#define EVENT_BATCH_SIZE 16
+
+typedef struct event_reader {
+	struct gpiod_line *line;
+	int fd;
+	int timer_fd;
+	int count;
+	int offset;
+	gpiod_frequency_latency *latency;
+	struct gpiod_line_event events[EVENT_BATCH_SIZE];
+} event_reader;
+
+int event_reader_init(
+	event_reader *self,
 	struct gpiod_line *line,
-	struct gpiod_line_event *ev,
+	const struct timespec *start,
 	const struct timespec *timeout
 );
+void event_reader_destroy(event_reader *self);
+int event_reader_skip(event_reader *self, const struct timespec *start);
+
+int read_event(event_reader *self, struct gpiod_line_event *ev);
+
+void latency_add(
+	gpiod_frequency_latency *latency,
+	const struct timespec *wakeup,
+	const struct gpiod_line_event *ev
+);
+
+/* Scheduling state of the calling thread, see rt_save() */
+typedef struct rt_state {
+	int policy;
+	int priority;
+	uint64_t affinity[16];
+} rt_state;
+
+int rt_save(rt_state *state);
+void rt_restore(const rt_state *state);
+
+typedef struct period_sums {
+	size_t count;
+	double sum;
+	double sum_sq;
+	double min;
+	double max;
+} period_sums;
 
-double get_period(double *buf, int size);
+void get_period_sums(const double *buf, size_t size, period_sums *res);
+double get_period(const double *buf, size_t size);
 
 #endif
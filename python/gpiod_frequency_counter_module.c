@@ -1,6 +1,7 @@
 #include <Python.h>
 #include <gpiod.h>
 #include <gpiod_frequency_counter.h>
+#include <gpiod_frequency_counter_pool.h>
 
 typedef struct {
 	PyObject_HEAD
@@ -8,12 +9,54 @@ typedef struct {
 	PyObject *owner;
 } gpiod_LineObject;
 
+typedef struct {
+	PyObject_HEAD
+	gpiod_frequency_histogram histogram;
+	/* count() updates it without the GIL, so one counter at a time */
+	PyObject *counter;
+} gpiod_frequency_counter_HistogramObject;
+
+/*
+ * count() releases the GIL, so a counter used from two threads at once
+ * is refused instead of locked. Streams keep the lines requested and
+ * point into the counter, so it cannot be reinitialized while they live.
+ */
+typedef struct {
+	int busy;
+	Py_ssize_t streams;
+} counter_state;
+
 typedef struct {
 	PyObject_HEAD
 	struct gpiod_frequency_counter counter;
 	PyObject *line;
+	PyObject *histogram;
+	counter_state state;
 } gpiod_frequency_counter_FrequencyCounterObject;
 
+typedef struct {
+	PyObject_HEAD
+	struct gpiod_frequency_counter_pool pool;
+	PyObject *lines;
+	counter_state state;
+} gpiod_frequency_counter_MultiFrequencyCounterObject;
+
+typedef struct {
+	PyObject_HEAD
+	PyObject *owner;
+	counter_state *state;
+	int (*count)(PyObject *owner, int waves, const struct timespec *timeout);
+	PyObject* (*result)(PyObject *owner);
+	void (*release)(PyObject *owner);
+	int waves;
+	struct timespec ts;
+	struct timespec *pts;
+	Py_ssize_t remaining;
+} gpiod_frequency_counter_StreamObject;
+
+static PyTypeObject gpiod_frequency_counter_HistogramType;
+static PyTypeObject gpiod_frequency_counter_StreamType;
+
 static struct gpiod_line* get_line_from_object(PyObject *object) {
 	gpiod_LineObject *line_object = (void*)object; ///
 	return line_object->line;
@@ -29,6 +72,128 @@ static PyObject* get_gpiod_line_type() {
 	return gpiod_Line;
 }
 
+static int counter_enter(counter_state *state) {
+	if (state->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "Counter is in use by another thread");
+		return -1;
+	}
+	state->busy = 1;
+	return 0;
+}
+
+static void counter_leave(counter_state *state) {
+	state->busy = 0;
+}
+
+static void counter_detach_histogram(
+	gpiod_frequency_counter_FrequencyCounterObject *self
+) {
+	if (self->histogram) {
+		((gpiod_frequency_counter_HistogramObject*)self->histogram)->counter = NULL;
+		Py_CLEAR(self->histogram);
+	}
+}
+
+static int counter_check_reinit(counter_state *state, int requested) {
+	if (state->busy || state->streams || requested) {
+		PyErr_SetString(
+			PyExc_RuntimeError,
+			"Cannot reinitialize a counter that is in use"
+		);
+		return -1;
+	}
+	return 0;
+}
+
+static int parse_count_args(
+	PyObject *args,
+	PyObject *kwargs,
+	int *waves,
+	struct timespec *ts,
+	struct timespec **pts,
+	Py_ssize_t *windows
+) {
+	static char *kwlist[] = { "waves", "sec", "nsec", "count", NULL };
+	long sec = 0;
+	long nsec = 0;
+	PyObject *count = Py_None;
+	int rc = PyArg_ParseTupleAndKeywords(
+		args, kwargs,
+		windows ? "|illO" : "|ill", kwlist,
+		waves, &sec, &nsec, &count
+	);
+	if (!rc) {
+		return -1;
+	}
+	*pts = NULL;
+	if (sec > 0 || (sec == 0 && nsec > 0)) {
+		ts->tv_sec = sec;
+		ts->tv_nsec = nsec;
+		*pts = ts;
+	}
+	if (windows) {
+		*windows = -1;
+		if (count != Py_None) {
+			*windows = PyLong_AsSsize_t(count);
+			if (*windows == -1 && PyErr_Occurred()) {
+				return -1;
+			}
+			if (*windows < 0) {
+				PyErr_SetString(PyExc_ValueError, "Count must not be negative");
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static PyObject* stream_new(
+	PyObject *owner,
+	counter_state *state,
+	int (*request)(PyObject *owner),
+	int (*count)(PyObject *owner, int waves, const struct timespec *timeout),
+	PyObject* (*result)(PyObject *owner),
+	void (*release)(PyObject *owner),
+	PyObject *args,
+	PyObject *kwargs
+) {
+	gpiod_frequency_counter_StreamObject *self = PyObject_New(
+		gpiod_frequency_counter_StreamObject,
+		&gpiod_frequency_counter_StreamType
+	);
+	if (!self) {
+		return NULL;
+	}
+	self->owner = NULL;
+	self->waves = 0;
+	int rc;
+	if (parse_count_args(
+		args, kwargs,
+		&self->waves, &self->ts, &self->pts, &self->remaining
+	)) {
+		Py_DECREF(self);
+		return NULL;
+	}
+	if (counter_enter(state)) {
+		Py_DECREF(self);
+		return NULL;
+	}
+	rc = request(owner);
+	counter_leave(state);
+	if (rc) {
+		Py_DECREF(self);
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	++state->streams;
+	Py_INCREF(owner);
+	self->owner = owner;
+	self->state = state;
+	self->count = count;
+	self->result = result;
+	self->release = release;
+	return (PyObject*)self;
+}
+
 static int gpiod_frequency_counter_FrequencyCounter_init(
 	gpiod_frequency_counter_FrequencyCounterObject *self,
 	PyObject *args,
@@ -69,6 +234,14 @@ static int gpiod_frequency_counter_FrequencyCounter_init(
 	if (!line) {
 		return -1;
 	}
+	if (self->line) {
+		if (counter_check_reinit(&self->state, self->counter.requested)) {
+			return -1;
+		}
+		gpiod_frequency_counter_destroy(&self->counter);
+		Py_CLEAR(self->line);
+		counter_detach_histogram(self);
+	}
 	rc = gpiod_frequency_counter_init(
 		&self->counter,
 		line,
@@ -92,6 +265,7 @@ static void gpiod_frequency_counter_FrequencyCounter_dealloc(
 	if (self->line) {
 		Py_DECREF(self->line);
 	}
+	counter_detach_histogram(self);
 	PyObject_Del(self);
 }
 
@@ -123,7 +297,11 @@ static PyObject* gpiod_frequency_counter_FrequencyCounter_reset(
 	PyObject *Py_UNUSED(args),
 	PyObject *Py_UNUSED(kwargs)
 ) {
+	if (counter_enter(&self->state)) {
+		return NULL;
+	}
 	gpiod_frequency_counter_reset(&self->counter);
+	counter_leave(&self->state);
 	Py_RETURN_NONE;
 }
 
@@ -146,31 +324,21 @@ static PyObject* gpiod_frequency_counter_FrequencyCounter_count(
 	PyObject *args,
 	PyObject *kwargs
 ) {
-	static char *kwlist[] = { "waves", "sec", "nsec", NULL };
-
 	int waves = 0;
-	long sec = 0;
-	long nsec = 0;
 	struct timespec ts;
-	struct timespec *pts = NULL;
-
-	int rc = PyArg_ParseTupleAndKeywords(
-		args, kwargs,
-		"|ill", kwlist,
-		&waves, &sec, &nsec
-	);
-	if (!rc) {
+	struct timespec *pts;
+	if (parse_count_args(args, kwargs, &waves, &ts, &pts, NULL)) {
 		return NULL;
 	}
-	if (sec > 0 || (sec == 0 && nsec > 0)) {
-		ts.tv_sec = sec;
-		ts.tv_nsec = nsec;
-		pts = &ts;
-	}
 
+	if (counter_enter(&self->state)) {
+		return NULL;
+	}
+	int rc;
 	Py_BEGIN_ALLOW_THREADS;
 	rc = gpiod_frequency_counter_count(&self->counter, waves, pts);
 	Py_END_ALLOW_THREADS;
+	counter_leave(&self->state);
 	if (rc) {
 		return PyErr_SetFromErrno(PyExc_OSError);
 	}
@@ -178,6 +346,68 @@ static PyObject* gpiod_frequency_counter_FrequencyCounter_count(
 	Py_RETURN_NONE;
 }
 
+static int frequency_counter_request(PyObject *owner) {
+	gpiod_frequency_counter_FrequencyCounterObject *self = (void*)owner;
+	return gpiod_frequency_counter_request(&self->counter);
+}
+
+static int frequency_counter_count(
+	PyObject *owner,
+	int waves,
+	const struct timespec *timeout
+) {
+	gpiod_frequency_counter_FrequencyCounterObject *self = (void*)owner;
+	return gpiod_frequency_counter_count(&self->counter, waves, timeout);
+}
+
+static PyObject* frequency_counter_result(PyObject *owner) {
+	gpiod_frequency_counter_FrequencyCounterObject *self = (void*)owner;
+	return Py_BuildValue(
+		"(ddd)",
+		gpiod_frequency_counter_get_frequency(&self->counter),
+		gpiod_frequency_counter_get_period(&self->counter),
+		gpiod_frequency_counter_get_duty_cycle(&self->counter)
+	);
+}
+
+static void frequency_counter_release(PyObject *owner) {
+	gpiod_frequency_counter_FrequencyCounterObject *self = (void*)owner;
+	gpiod_frequency_counter_release(&self->counter);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_FrequencyCounter_stream_doc,
+"stream([waves, [sec, [nsec, [count]]]]) -> iterator\n"
+"\n"
+"Keep the line requested and count GPIO input frequency repeatedly.\n"
+"Yields a (frequency, period, duty_cycle) tuple per window.\n"
+"\n"
+"  waves\n"
+"    Number of waves to count per window (default: buf_size).\n"
+"  sec\n"
+"    Number of seconds before timeout (default: no timeout).\n"
+"  nsec\n"
+"    Number of nanoseconds before timeout (default: no timeout).\n"
+"  count\n"
+"    Number of windows (default: unlimited).\n"
+);
+
+static PyObject* gpiod_frequency_counter_FrequencyCounter_stream(
+	gpiod_frequency_counter_FrequencyCounterObject *self,
+	PyObject *args,
+	PyObject *kwargs
+) {
+	return stream_new(
+		(PyObject*)self,
+		&self->state,
+		frequency_counter_request,
+		frequency_counter_count,
+		frequency_counter_result,
+		frequency_counter_release,
+		args,
+		kwargs
+	);
+}
+
 PyDoc_STRVAR(gpiod_frequency_counter_FrequencyCounter_get_buf_size_doc,
 "Wave period buffer size (integer)."
 );
@@ -272,6 +502,102 @@ static PyObject* gpiod_frequency_counter_FrequencyCounter_get_duty_cycle(
 	return PyFloat_FromDouble(res);
 }
 
+PyDoc_STRVAR(gpiod_frequency_counter_FrequencyCounter_ema_tau_doc,
+"Exponential moving average time constant in seconds (float).\n"
+"\n"
+"0 uses the mean of the wave period buffer.\n"
+);
+
+static PyObject* gpiod_frequency_counter_FrequencyCounter_get_ema_tau(
+	gpiod_frequency_counter_FrequencyCounterObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	return PyFloat_FromDouble(self->counter.ema_tau);
+}
+
+static int gpiod_frequency_counter_FrequencyCounter_set_ema_tau(
+	gpiod_frequency_counter_FrequencyCounterObject *self,
+	PyObject *value,
+	void *Py_UNUSED(closure)
+) {
+	if (!value) {
+		PyErr_SetString(PyExc_TypeError, "Cannot delete ema_tau");
+		return -1;
+	}
+	double tau = PyFloat_AsDouble(value);
+	if (tau == -1.0 && PyErr_Occurred()) {
+		return -1;
+	}
+	if (counter_enter(&self->state)) {
+		return -1;
+	}
+	int rc = gpiod_frequency_counter_set_ema(&self->counter, tau);
+	counter_leave(&self->state);
+	if (rc) {
+		PyErr_SetFromErrno(PyExc_ValueError);
+		return -1;
+	}
+	return 0;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_FrequencyCounter_histogram_doc,
+"Period histogram updated by count() (Histogram or None).\n"
+"\n"
+"A histogram can be attached to one counter at a time, and is not to be\n"
+"reset or merged into while the counter counts in another thread.\n"
+);
+
+static PyObject* gpiod_frequency_counter_FrequencyCounter_get_histogram(
+	gpiod_frequency_counter_FrequencyCounterObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	if (!self->histogram) {
+		Py_RETURN_NONE;
+	}
+	Py_INCREF(self->histogram);
+	return self->histogram;
+}
+
+static int gpiod_frequency_counter_FrequencyCounter_set_histogram(
+	gpiod_frequency_counter_FrequencyCounterObject *self,
+	PyObject *value,
+	void *Py_UNUSED(closure)
+) {
+	gpiod_frequency_counter_HistogramObject *histogram = NULL;
+	if (value == Py_None) {
+		value = NULL;
+	}
+	if (value) {
+		if (!PyObject_TypeCheck(value, &gpiod_frequency_counter_HistogramType)) {
+			PyErr_SetString(PyExc_TypeError, "Histogram or None expected");
+			return -1;
+		}
+		histogram = (gpiod_frequency_counter_HistogramObject*)value;
+		if (histogram->counter && histogram->counter != (PyObject*)self) {
+			PyErr_SetString(
+				PyExc_ValueError,
+				"Histogram is attached to another counter"
+			);
+			return -1;
+		}
+	}
+	if (counter_enter(&self->state)) {
+		return -1;
+	}
+	Py_XINCREF(value);
+	counter_detach_histogram(self);
+	self->histogram = value;
+	if (histogram) {
+		histogram->counter = (PyObject*)self;
+	}
+	gpiod_frequency_counter_set_histogram(
+		&self->counter,
+		histogram ? &histogram->histogram : NULL
+	);
+	counter_leave(&self->state);
+	return 0;
+}
+
 PyDoc_STRVAR(gpiod_frequency_counter_FrequencyCounterType_doc,
 "Represents a GPIO input frequency counter.\n"
 "\n"
@@ -304,6 +630,12 @@ static PyMethodDef gpiod_frequency_counter_FrequencyCounter_methods[] = {
 		.ml_flags = METH_NOARGS,
 		.ml_doc = gpiod_frequency_counter_FrequencyCounter_reset_doc,
 	},
+	{
+		.ml_name = "stream",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_FrequencyCounter_stream,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = gpiod_frequency_counter_FrequencyCounter_stream_doc,
+	},
 	{}
 };
 
@@ -348,6 +680,18 @@ static PyGetSetDef gpiod_frequency_counter_FrequencyCounter_getset[] = {
 		.get = (getter)gpiod_frequency_counter_FrequencyCounter_get_duty_cycle,
 		.doc = gpiod_frequency_counter_FrequencyCounter_get_duty_cycle_doc,
 	},
+	{
+		.name = "ema_tau",
+		.get = (getter)gpiod_frequency_counter_FrequencyCounter_get_ema_tau,
+		.set = (setter)gpiod_frequency_counter_FrequencyCounter_set_ema_tau,
+		.doc = gpiod_frequency_counter_FrequencyCounter_ema_tau_doc,
+	},
+	{
+		.name = "histogram",
+		.get = (getter)gpiod_frequency_counter_FrequencyCounter_get_histogram,
+		.set = (setter)gpiod_frequency_counter_FrequencyCounter_set_histogram,
+		.doc = gpiod_frequency_counter_FrequencyCounter_histogram_doc,
+	},
 	{}
 };
 
@@ -365,6 +709,571 @@ static PyTypeObject gpiod_frequency_counter_FrequencyCounterType = {
 	.tp_getset = gpiod_frequency_counter_FrequencyCounter_getset,
 };
 
+static int gpiod_frequency_counter_Histogram_init(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *args,
+	PyObject *kwargs
+) {
+	static char *kwlist[] = { NULL };
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "", kwlist)) {
+		return -1;
+	}
+	gpiod_frequency_histogram_reset(&self->histogram);
+	return 0;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Histogram_reset_doc,
+"reset() -> None\n"
+"\n"
+"Clear all bins.\n"
+);
+
+static PyObject* gpiod_frequency_counter_Histogram_reset(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	gpiod_frequency_histogram_reset(&self->histogram);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Histogram_merge_doc,
+"merge(other) -> None\n"
+"\n"
+"Add bin counts of another histogram.\n"
+);
+
+static PyObject* gpiod_frequency_counter_Histogram_merge(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *other
+) {
+	if (!PyObject_TypeCheck(other, &gpiod_frequency_counter_HistogramType)) {
+		PyErr_SetString(PyExc_TypeError, "Histogram expected");
+		return NULL;
+	}
+	gpiod_frequency_histogram_merge(
+		&self->histogram,
+		&((gpiod_frequency_counter_HistogramObject*)other)->histogram
+	);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Histogram_percentile_doc,
+"percentile(p) -> float\n"
+"\n"
+"Period in seconds at percentile p (0-100), nan if empty.\n"
+);
+
+static PyObject* gpiod_frequency_counter_Histogram_percentile(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *arg
+) {
+	double p = PyFloat_AsDouble(arg);
+	if (p == -1.0 && PyErr_Occurred()) {
+		return NULL;
+	}
+	return PyFloat_FromDouble(
+		gpiod_frequency_histogram_get_percentile(&self->histogram, p)
+	);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Histogram_bins_doc,
+"bins() -> list\n"
+"\n"
+"Non-empty bins as (lower, upper, count) tuples, bounds in seconds.\n"
+);
+
+static PyObject* gpiod_frequency_counter_Histogram_bins(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	PyObject *res = PyList_New(0);
+	if (!res) {
+		return NULL;
+	}
+	for (size_t i = 0; i < GPIOD_FREQUENCY_HISTOGRAM_BINS; ++i) {
+		uint64_t count = self->histogram.bins[i];
+		if (!count) {
+			continue;
+		}
+		uint64_t upper = gpiod_frequency_histogram_get_bin_upper(i);
+		PyObject *bin = Py_BuildValue(
+			"ddK",
+			1e-9 * gpiod_frequency_histogram_get_bin_lower(i),
+			upper == UINT64_MAX ? Py_HUGE_VAL : 1e-9 * upper,
+			(unsigned long long)count
+		);
+		if (!bin || PyList_Append(res, bin)) {
+			Py_XDECREF(bin);
+			Py_DECREF(res);
+			return NULL;
+		}
+		Py_DECREF(bin);
+	}
+	return res;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Histogram_get_count_doc,
+"Number of recorded periods (integer)."
+);
+
+static PyObject* gpiod_frequency_counter_Histogram_get_count(
+	gpiod_frequency_counter_HistogramObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	return PyLong_FromUnsignedLongLong(self->histogram.count);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_HistogramType_doc,
+"Log-scale wave period histogram.\n"
+"\n"
+"Example:\n"
+"\n"
+"    histogram = gpiod_frequency_counter.Histogram()\n"
+"    counter.histogram = histogram\n"
+"    counter.count(sec=1)\n"
+"    print(histogram.percentile(50), histogram.percentile(99))\n"
+);
+
+static PyMethodDef gpiod_frequency_counter_Histogram_methods[] = {
+	{
+		.ml_name = "reset",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_Histogram_reset,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_frequency_counter_Histogram_reset_doc,
+	},
+	{
+		.ml_name = "merge",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_Histogram_merge,
+		.ml_flags = METH_O,
+		.ml_doc = gpiod_frequency_counter_Histogram_merge_doc,
+	},
+	{
+		.ml_name = "percentile",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_Histogram_percentile,
+		.ml_flags = METH_O,
+		.ml_doc = gpiod_frequency_counter_Histogram_percentile_doc,
+	},
+	{
+		.ml_name = "bins",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_Histogram_bins,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_frequency_counter_Histogram_bins_doc,
+	},
+	{}
+};
+
+static PyGetSetDef gpiod_frequency_counter_Histogram_getset[] = {
+	{
+		.name = "count",
+		.get = (getter)gpiod_frequency_counter_Histogram_get_count,
+		.doc = gpiod_frequency_counter_Histogram_get_count_doc,
+	},
+	{}
+};
+
+static PyTypeObject gpiod_frequency_counter_HistogramType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gpiod_frequency_counter.Histogram",
+	.tp_basicsize = sizeof(gpiod_frequency_counter_HistogramObject),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_doc = gpiod_frequency_counter_HistogramType_doc,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)gpiod_frequency_counter_Histogram_init,
+	.tp_methods = gpiod_frequency_counter_Histogram_methods,
+	.tp_getset = gpiod_frequency_counter_Histogram_getset,
+};
+
+static PyObject* gpiod_frequency_counter_Stream_close(
+	gpiod_frequency_counter_StreamObject *self,
+	PyObject *Py_UNUSED(args)
+);
+
+static void gpiod_frequency_counter_Stream_dealloc(
+	gpiod_frequency_counter_StreamObject *self
+) {
+	gpiod_frequency_counter_Stream_close(self, NULL);
+	PyObject_Del(self);
+}
+
+static PyObject* gpiod_frequency_counter_Stream_next(
+	gpiod_frequency_counter_StreamObject *self
+) {
+	if (!self->owner || self->remaining == 0) {
+		return NULL;
+	}
+	if (counter_enter(self->state)) {
+		return NULL;
+	}
+	int rc;
+	Py_BEGIN_ALLOW_THREADS;
+	rc = self->count(self->owner, self->waves, self->pts);
+	Py_END_ALLOW_THREADS;
+	counter_leave(self->state);
+	if (rc) {
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	if (self->remaining > 0) {
+		--self->remaining;
+	}
+	return self->result(self->owner);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_Stream_close_doc,
+"close() -> None\n"
+"\n"
+"Stop iteration. The GPIO lines are released with the last stream.\n"
+);
+
+static PyObject* gpiod_frequency_counter_Stream_close(
+	gpiod_frequency_counter_StreamObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	if (self->owner) {
+		if (!--self->state->streams) {
+			self->release(self->owner);
+		}
+		Py_CLEAR(self->owner);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef gpiod_frequency_counter_Stream_methods[] = {
+	{
+		.ml_name = "close",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_Stream_close,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_frequency_counter_Stream_close_doc,
+	},
+	{}
+};
+
+PyDoc_STRVAR(gpiod_frequency_counter_StreamType_doc,
+"Iterator over counting windows, returned by stream().\n"
+);
+
+static PyTypeObject gpiod_frequency_counter_StreamType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gpiod_frequency_counter.Stream",
+	.tp_basicsize = sizeof(gpiod_frequency_counter_StreamObject),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_doc = gpiod_frequency_counter_StreamType_doc,
+	.tp_dealloc = (destructor)gpiod_frequency_counter_Stream_dealloc,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)gpiod_frequency_counter_Stream_next,
+	.tp_methods = gpiod_frequency_counter_Stream_methods,
+};
+
+static int gpiod_frequency_counter_MultiFrequencyCounter_init(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *args,
+	PyObject *kwargs
+) {
+	static char *kwlist[] = {
+		"lines",
+		"buf_size",
+		"name",
+		"flags",
+		NULL
+	};
+	PyObject *lines_object;
+	char *name = NULL;
+	int flags = 0;
+	unsigned buf_size;
+	int rc = PyArg_ParseTupleAndKeywords(
+		args, kwargs,
+		"OI|si", kwlist,
+		&lines_object,
+		&buf_size,
+		&name,
+		&flags
+	);
+	if (!rc) {
+		return -1;
+	}
+	if (buf_size < 1) {
+		PyErr_SetString(PyExc_ValueError, "Buffer size must be greater than 0");
+		return -1;
+	}
+	PyObject *line_type = get_gpiod_line_type();
+	if (!line_type) {
+		return -1;
+	}
+	PyObject *lines = PySequence_Tuple(lines_object);
+	if (!lines) {
+		Py_DECREF(line_type);
+		return -1;
+	}
+	Py_ssize_t size = PyTuple_GET_SIZE(lines);
+	struct gpiod_line **line_ptrs = PyMem_Calloc(size ? size : 1, sizeof(*line_ptrs));
+	if (!line_ptrs) {
+		PyErr_NoMemory();
+		goto error;
+	}
+	for (Py_ssize_t i = 0; i < size; ++i) {
+		PyObject *line = PyTuple_GET_ITEM(lines, i);
+		rc = PyObject_IsInstance(line, line_type);
+		if (rc <= 0) {
+			if (rc == 0) {
+				PyErr_SetString(PyExc_TypeError, "gpiod.Line expected");
+			}
+			goto error;
+		}
+		line_ptrs[i] = get_line_from_object(line);
+	}
+	if (counter_check_reinit(&self->state, self->pool.requested)) {
+		goto error;
+	}
+	gpiod_frequency_counter_pool_destroy(&self->pool);
+	rc = gpiod_frequency_counter_pool_init(
+		&self->pool,
+		line_ptrs,
+		size,
+		buf_size,
+		name,
+		flags
+	);
+	if (rc) {
+		PyErr_SetFromErrno(PyExc_OSError);
+		goto error;
+	}
+	PyMem_Free(line_ptrs);
+	Py_DECREF(line_type);
+	Py_XSETREF(self->lines, lines);
+	return 0;
+error:
+	PyMem_Free(line_ptrs);
+	Py_DECREF(line_type);
+	Py_DECREF(lines);
+	return -1;
+}
+
+static void gpiod_frequency_counter_MultiFrequencyCounter_dealloc(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self
+) {
+	gpiod_frequency_counter_pool_destroy(&self->pool);
+	Py_XDECREF(self->lines);
+	PyObject_Del(self);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounter_reset_doc,
+"reset() -> None\n"
+"\n"
+"Clear wave period buffers of all lines.\n"
+);
+
+static PyObject* gpiod_frequency_counter_MultiFrequencyCounter_reset(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	if (counter_enter(&self->state)) {
+		return NULL;
+	}
+	gpiod_frequency_counter_pool_reset(&self->pool);
+	counter_leave(&self->state);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounter_count_doc,
+"count([waves, [sec, [nsec]]]) -> None\n"
+"\n"
+"Count GPIO input frequency on all lines at once.\n"
+"\n"
+"  waves\n"
+"    Number of waves to count per line (default: buf_size).\n"
+"  sec\n"
+"    Number of seconds before timeout (default: no timeout).\n"
+"  nsec\n"
+"    Number of nanoseconds before timeout (default: no timeout).\n"
+);
+
+static PyObject* gpiod_frequency_counter_MultiFrequencyCounter_count(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *args,
+	PyObject *kwargs
+) {
+	int waves = 0;
+	struct timespec ts;
+	struct timespec *pts;
+	if (parse_count_args(args, kwargs, &waves, &ts, &pts, NULL)) {
+		return NULL;
+	}
+	if (counter_enter(&self->state)) {
+		return NULL;
+	}
+	int rc;
+	Py_BEGIN_ALLOW_THREADS;
+	rc = gpiod_frequency_counter_pool_count(&self->pool, waves, pts);
+	Py_END_ALLOW_THREADS;
+	counter_leave(&self->state);
+	if (rc) {
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	Py_RETURN_NONE;
+}
+
+static int multi_frequency_counter_request(PyObject *owner) {
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self = (void*)owner;
+	return gpiod_frequency_counter_pool_request(&self->pool);
+}
+
+static int multi_frequency_counter_count(
+	PyObject *owner,
+	int waves,
+	const struct timespec *timeout
+) {
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self = (void*)owner;
+	return gpiod_frequency_counter_pool_count(&self->pool, waves, timeout);
+}
+
+static PyObject* multi_frequency_counter_result(PyObject *owner) {
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self = (void*)owner;
+	gpiod_frequency_counter_pool *pool = &self->pool;
+	PyObject *res = PyTuple_New(pool->size);
+	if (!res) {
+		return NULL;
+	}
+	for (size_t i = 0; i < pool->size; ++i) {
+		PyObject *item = Py_BuildValue(
+			"(ddd)",
+			gpiod_frequency_counter_pool_get_frequency(pool, i),
+			gpiod_frequency_counter_pool_get_period(pool, i),
+			gpiod_frequency_counter_pool_get_duty_cycle(pool, i)
+		);
+		if (!item) {
+			Py_DECREF(res);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(res, i, item);
+	}
+	return res;
+}
+
+static void multi_frequency_counter_release(PyObject *owner) {
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self = (void*)owner;
+	gpiod_frequency_counter_pool_release(&self->pool);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounter_stream_doc,
+"stream([waves, [sec, [nsec, [count]]]]) -> iterator\n"
+"\n"
+"Keep all lines requested and count GPIO input frequency repeatedly.\n"
+"Yields a tuple of (frequency, period, duty_cycle) tuples per window,\n"
+"one for each line.\n"
+"\n"
+"  waves\n"
+"    Number of waves to count per line and window (default: buf_size).\n"
+"  sec\n"
+"    Number of seconds before timeout (default: no timeout).\n"
+"  nsec\n"
+"    Number of nanoseconds before timeout (default: no timeout).\n"
+"  count\n"
+"    Number of windows (default: unlimited).\n"
+);
+
+static PyObject* gpiod_frequency_counter_MultiFrequencyCounter_stream(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *args,
+	PyObject *kwargs
+) {
+	return stream_new(
+		(PyObject*)self,
+		&self->state,
+		multi_frequency_counter_request,
+		multi_frequency_counter_count,
+		multi_frequency_counter_result,
+		multi_frequency_counter_release,
+		args,
+		kwargs
+	);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounter_get_results_doc,
+"(frequency, period, duty_cycle) tuple for each line (tuple)."
+);
+
+static PyObject* gpiod_frequency_counter_MultiFrequencyCounter_get_results(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	return multi_frequency_counter_result((PyObject*)self);
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounter_get_lines_doc,
+"GPIO lines (tuple)."
+);
+
+static PyObject* gpiod_frequency_counter_MultiFrequencyCounter_get_lines(
+	gpiod_frequency_counter_MultiFrequencyCounterObject *self,
+	PyObject *Py_UNUSED(args)
+) {
+	if (!self->lines) {
+		return PyTuple_New(0);
+	}
+	Py_INCREF(self->lines);
+	return self->lines;
+}
+
+PyDoc_STRVAR(gpiod_frequency_counter_MultiFrequencyCounterType_doc,
+"Represents GPIO input frequency counters for several lines.\n"
+"\n"
+"Example:\n"
+"\n"
+"    chip = gpiod.Chip('gpiochip0', gpiod.Chip.OPEN_BY_NAME)\n"
+"    lines = [chip.get_line(i) for i in range(4)]\n"
+"    counter = gpiod_frequency_counter.MultiFrequencyCounter(lines, 32)\n"
+"    for window in counter.stream(sec=1):\n"
+"        print(window)\n"
+);
+
+static PyMethodDef gpiod_frequency_counter_MultiFrequencyCounter_methods[] = {
+	{
+		.ml_name = "count",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_MultiFrequencyCounter_count,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = gpiod_frequency_counter_MultiFrequencyCounter_count_doc,
+	},
+	{
+		.ml_name = "stream",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_MultiFrequencyCounter_stream,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = gpiod_frequency_counter_MultiFrequencyCounter_stream_doc,
+	},
+	{
+		.ml_name = "reset",
+		.ml_meth = (PyCFunction)gpiod_frequency_counter_MultiFrequencyCounter_reset,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_frequency_counter_MultiFrequencyCounter_reset_doc,
+	},
+	{}
+};
+
+static PyGetSetDef gpiod_frequency_counter_MultiFrequencyCounter_getset[] = {
+	{
+		.name = "lines",
+		.get = (getter)gpiod_frequency_counter_MultiFrequencyCounter_get_lines,
+		.doc = gpiod_frequency_counter_MultiFrequencyCounter_get_lines_doc,
+	},
+	{
+		.name = "results",
+		.get = (getter)gpiod_frequency_counter_MultiFrequencyCounter_get_results,
+		.doc = gpiod_frequency_counter_MultiFrequencyCounter_get_results_doc,
+	},
+	{}
+};
+
+static PyTypeObject gpiod_frequency_counter_MultiFrequencyCounterType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gpiod_frequency_counter.MultiFrequencyCounter",
+	.tp_basicsize = sizeof(gpiod_frequency_counter_MultiFrequencyCounterObject),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_doc = gpiod_frequency_counter_MultiFrequencyCounterType_doc,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)gpiod_frequency_counter_MultiFrequencyCounter_init,
+	.tp_dealloc = (destructor)gpiod_frequency_counter_MultiFrequencyCounter_dealloc,
+	.tp_methods = gpiod_frequency_counter_MultiFrequencyCounter_methods,
+	.tp_getset = gpiod_frequency_counter_MultiFrequencyCounter_getset,
+};
+
 PyDoc_STRVAR(gpiod_frequency_counter_Module_doc,
 "Python bindings for libgpiod-frequency-counter.\n"
 );
@@ -381,14 +1290,26 @@ PyMODINIT_FUNC PyInit_gpiod_frequency_counter() {
 	if (!module) {
 		return NULL;
 	}
-	PyTypeObject *type = &gpiod_frequency_counter_FrequencyCounterType;
-	const char *name = "FrequencyCounter";
-	if (PyType_Ready(type)) {
-		return NULL;
-	}
-	Py_INCREF(type);
-	if (PyModule_AddObject(module, name, (PyObject*)type) < 0) {
-		return NULL;
+	struct {
+		const char *name;
+		PyTypeObject *type;
+	} types[] = {
+		{ "FrequencyCounter", &gpiod_frequency_counter_FrequencyCounterType },
+		{ "Histogram", &gpiod_frequency_counter_HistogramType },
+		{
+			"MultiFrequencyCounter",
+			&gpiod_frequency_counter_MultiFrequencyCounterType
+		},
+		{ "Stream", &gpiod_frequency_counter_StreamType },
+	};
+	for (size_t i = 0; i < sizeof(types) / sizeof(*types); ++i) {
+		if (PyType_Ready(types[i].type)) {
+			return NULL;
+		}
+		Py_INCREF(types[i].type);
+		if (PyModule_AddObject(module, types[i].name, (PyObject*)types[i].type) < 0) {
+			return NULL;
+		}
 	}
 	const char *version = gpiod_frequency_counter_version_string();
 	if (PyModule_AddStringConstant(module, "__version__", version) < 0) {
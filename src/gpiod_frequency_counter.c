@@ -2,9 +2,20 @@
 #include <gpiod_frequency_counter.h>
 
 #include <math.h>
+#include <stdalign.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static const char default_name[] = "gpiod_frequency_counter";
+
+static size_t storage_size(size_t buf_size, size_t name_len) {
+	size_t size = 2 * buf_size * sizeof(double) + name_len + 1;
+	return (size + alignof(double) - 1) / alignof(double) * alignof(double);
+}
 
 EXPORT int gpiod_frequency_counter_init(
 	gpiod_frequency_counter *self,
@@ -17,14 +28,28 @@ EXPORT int gpiod_frequency_counter_init(
 	self->period_buf_size = buf_size;
 	self->name = NULL;
 	self->flags = flags;
+	self->own_storage = 1;
+	self->requested = 0;
+	self->estimator = GPIOD_FREQUENCY_COUNTER_MEAN;
+	self->ema_tau = 0.0;
+	self->alarm = NULL;
+	self->histogram = NULL;
+	self->logger = NULL;
+	self->rt = NULL;
+	gpiod_frequency_latency_reset(&self->latency);
+	memset(&self->last_event, 0, sizeof(self->last_event));
+	memset(self->last_period, 0, sizeof(self->last_period));
 	memset(self->period_buf, 0, sizeof(self->period_buf));
 	memset(self->period_buf_offset, 0, sizeof(self->period_buf_offset));
-	self->name = strdup(name ? name: "gpiod_frequency_counter");
+	self->name = strdup(name ? name : default_name);
 	if (!self->name) {
 		goto error;
 	}
 	for (int i = 0; i < 2; ++i) {
 		self->period[i] = INFINITY;
+		if (!buf_size) {
+			continue;
+		}
 		self->period_buf[i] = calloc(buf_size, sizeof(**self->period_buf));
 		if (!self->period_buf[i]) {
 			goto error;
@@ -36,11 +61,107 @@ error:
 	return -1;
 }
 
+/*
+ * Storage layout: low period buffer, high period buffer, name.
+ * Storage must be aligned for double. Consecutive counters can be
+ * carved from one arena at gpiod_frequency_counter_storage_stride()
+ * intervals.
+ */
+EXPORT int gpiod_frequency_counter_init_with_storage(
+	gpiod_frequency_counter *self,
+	struct gpiod_line *line,
+	size_t buf_size,
+	const char *name,
+	int flags,
+	void *storage,
+	size_t size
+) {
+	if (!name) {
+		name = default_name;
+	}
+	size_t name_len = strlen(name);
+	if ((uintptr_t)storage % alignof(double)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (size < storage_size(buf_size, name_len)) {
+		errno = ENOBUFS;
+		return -1;
+	}
+	double *buf = storage;
+	memset(buf, 0, 2 * buf_size * sizeof(*buf));
+	self->line = line;
+	self->period_buf_size = buf_size;
+	self->flags = flags;
+	self->own_storage = 0;
+	self->requested = 0;
+	self->estimator = GPIOD_FREQUENCY_COUNTER_MEAN;
+	self->ema_tau = 0.0;
+	self->alarm = NULL;
+	self->histogram = NULL;
+	self->logger = NULL;
+	self->rt = NULL;
+	gpiod_frequency_latency_reset(&self->latency);
+	memset(&self->last_event, 0, sizeof(self->last_event));
+	memset(self->last_period, 0, sizeof(self->last_period));
+	memset(self->period_buf_offset, 0, sizeof(self->period_buf_offset));
+	for (int i = 0; i < 2; ++i) {
+		self->period[i] = INFINITY;
+		self->period_buf[i] = buf + i * buf_size;
+	}
+	self->name = (char*)(buf + 2 * buf_size);
+	memcpy(self->name, name, name_len + 1);
+	return 0;
+}
+
+EXPORT size_t gpiod_frequency_counter_storage_size(
+	size_t buf_size,
+	const char *name
+) {
+	return storage_size(buf_size, strlen(name ? name : default_name));
+}
+
+/*
+ * Distance between the storage of consecutive counters in an arena,
+ * always a multiple of the alignment of double.
+ */
+EXPORT size_t gpiod_frequency_counter_storage_stride(
+	size_t buf_size,
+	size_t max_name_len
+) {
+	if (max_name_len < sizeof(default_name) - 1) {
+		max_name_len = sizeof(default_name) - 1;
+	}
+	return storage_size(buf_size, max_name_len);
+}
+
+EXPORT size_t gpiod_frequency_counter_arena_size(
+	size_t count,
+	size_t buf_size,
+	size_t max_name_len
+) {
+	return count * gpiod_frequency_counter_storage_stride(buf_size, max_name_len);
+}
+
 EXPORT void gpiod_frequency_counter_destroy(gpiod_frequency_counter *self) {
 	if (self->line) {
-		//gpiod_line_release(self->line);
+		gpiod_frequency_counter_release(self);
 		self->line = NULL;
 	}
+	if (self->alarm) {
+		if (self->alarm->fd >= 0) {
+			close(self->alarm->fd);
+		}
+		free(self->alarm);
+		self->alarm = NULL;
+	}
+	self->histogram = NULL;
+	self->logger = NULL;
+	if (!self->own_storage) {
+		self->name = NULL;
+		memset(self->period_buf, 0, sizeof(self->period_buf));
+		return;
+	}
 	if (self->name) {
 		free(self->name);
 		self->name = NULL;
@@ -57,20 +178,141 @@ EXPORT void gpiod_frequency_counter_reset(gpiod_frequency_counter *self) {
 	size_t buf_size = self->period_buf_size * sizeof(**self->period_buf);
 	for (int i = 0; i < 2; ++i) {
 		self->period[i] = INFINITY;
-		memset(self->period_buf[i], 0, buf_size);
+		if (self->period_buf[i]) {
+			memset(self->period_buf[i], 0, buf_size);
+		}
 	}
 	memset(self->period_buf_offset, 0, sizeof(self->period_buf_offset));
+	memset(self->last_period, 0, sizeof(self->last_period));
+	memset(&self->last_event, 0, sizeof(self->last_event));
+	gpiod_frequency_latency_reset(&self->latency);
+	if (self->alarm) {
+		for (int i = 0; i < GPIOD_FREQUENCY_COUNTER_QUANTITIES; ++i) {
+			self->alarm->threshold[i].state =
+				GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+		}
+	}
 	//gpiod_line_release(self->line);
 }
 
-EXPORT int gpiod_frequency_counter_count(
+static void check_threshold(
 	gpiod_frequency_counter *self,
-	int waves,
-	const struct timespec *timeout
+	int quantity,
+	double value
 ) {
-	int rc = 0;
+	gpiod_frequency_counter_alarm *alarm = self->alarm;
+	gpiod_frequency_counter_threshold *th = &alarm->threshold[quantity];
+	int state = th->state;
+	if (value > th->high) {
+		state = GPIOD_FREQUENCY_COUNTER_ALARM_HIGH;
+	} else if (value < th->low) {
+		state = GPIOD_FREQUENCY_COUNTER_ALARM_LOW;
+	} else if (state == GPIOD_FREQUENCY_COUNTER_ALARM_HIGH) {
+		if (value < th->high - th->hysteresis) {
+			state = GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+		}
+	} else if (state == GPIOD_FREQUENCY_COUNTER_ALARM_LOW) {
+		if (value > th->low + th->hysteresis) {
+			state = GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+		}
+	}
+	if (state == th->state) {
+		return;
+	}
+	dbg("alarm: %d %d %.04lf\n", quantity, state, value);
+	th->state = state;
+	if (alarm->fd >= 0) {
+		uint64_t one = 1;
+		if (write(alarm->fd, &one, sizeof(one)) < 0) {
+			dbg("write: %s\n", strerror(errno));
+		}
+	}
+	if (alarm->callback) {
+		alarm->callback(self, quantity, state, value, alarm->data);
+	}
+}
+
+static void check_alarm(gpiod_frequency_counter *self) {
+	double low = self->last_period[0];
+	double high = self->last_period[1];
+	if (low <= 0.0 || high <= 0.0) {
+		return;
+	}
+	unsigned enabled = self->alarm->enabled;
+	double period = low + high;
+	if (enabled & (1 << GPIOD_FREQUENCY_COUNTER_PERIOD)) {
+		check_threshold(self, GPIOD_FREQUENCY_COUNTER_PERIOD, period);
+	}
+	if (enabled & (1 << GPIOD_FREQUENCY_COUNTER_FREQUENCY)) {
+		check_threshold(self, GPIOD_FREQUENCY_COUNTER_FREQUENCY, 1.0 / period);
+	}
+	if (enabled & (1 << GPIOD_FREQUENCY_COUNTER_DUTY_CYCLE)) {
+		check_threshold(self, GPIOD_FREQUENCY_COUNTER_DUTY_CYCLE, high / period);
+	}
+}
 
-	rc = gpiod_line_request_both_edges_events_flags(
+static inline void add_period(
+	gpiod_frequency_counter *self,
+	int value,
+	double period
+) {
+	if (self->estimator == GPIOD_FREQUENCY_COUNTER_EMA) {
+		/*
+		 * dt / (tau + dt) approximates 1 - exp(-dt / tau) without exp().
+		 * Each half is updated once per wave, so dt is the estimated full
+		 * period, not the sample: weighting by the sample would favour
+		 * long periods and bias the estimate low.
+		 */
+		double prev = self->period[value];
+		double other = self->period[!value];
+		if (prev == INFINITY) {
+			self->period[value] = period;
+		} else {
+			double dt = other == INFINITY ? prev : prev + other;
+			double alpha = dt / (self->ema_tau + dt);
+			self->period[value] = prev + alpha * (period - prev);
+		}
+	} else if (self->period_buf_size) {
+		self->period_buf[value][self->period_buf_offset[value]] = period;
+		++self->period_buf_offset[value];
+		self->period_buf_offset[value] %= self->period_buf_size;
+	}
+	self->last_period[value] = period;
+	if (self->histogram && value == 0 && self->last_period[1] > 0.0) {
+		double full = period + self->last_period[1];
+		gpiod_frequency_histogram_add(self->histogram, full * 1e9);
+	}
+	if (self->alarm && self->alarm->enabled) {
+		check_alarm(self);
+	}
+}
+
+static inline void add_event(
+	gpiod_frequency_counter *self,
+	const struct gpiod_line_event *ev
+) {
+	if (self->last_event.event_type) {
+		double period = timespec_diff_double(&self->last_event.ts, &ev->ts);
+		int value = self->last_event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+		dbg("period: %d %.04lfs\n", value, period);
+		add_period(self, value, period);
+	}
+	if (self->logger) {
+		gpiod_frequency_logger_add_event(self->logger, ev);
+	}
+	self->last_event = *ev;
+}
+
+/*
+ * Keeps the line requested across count() calls until
+ * gpiod_frequency_counter_release(). Without it, every count()
+ * requests and releases the line.
+ */
+EXPORT int gpiod_frequency_counter_request(gpiod_frequency_counter *self) {
+	if (self->requested) {
+		return 0;
+	}
+	int rc = gpiod_line_request_both_edges_events_flags(
 		self->line,
 		self->name,
 		self->flags
@@ -79,70 +321,130 @@ EXPORT int gpiod_frequency_counter_count(
 		dbg("gpiod_line_request_both_edges_events: %s\n", strerror(errno));
 		return -1;
 	}
+	self->requested = 1;
+	return 0;
+}
+
+EXPORT void gpiod_frequency_counter_release(gpiod_frequency_counter *self) {
+	if (self->requested) {
+		gpiod_line_release(self->line);
+		self->requested = 0;
+	}
+}
+
+EXPORT int gpiod_frequency_counter_count(
+	gpiod_frequency_counter *self,
+	int waves,
+	const struct timespec *timeout
+) {
+	int rc = 0;
+	int persistent = self->requested;
+	int restore = 0;
+	rt_state saved;
+
+	if (gpiod_frequency_counter_request(self)) {
+		return -1;
+	}
+	if (self->rt) {
+		if (rt_save(&saved)) {
+			rc = -1;
+			goto release;
+		}
+		restore = 1;
+		if (gpiod_frequency_rt_apply(self->rt)) {
+			rc = -1;
+			goto release;
+		}
+	}
 
 	struct timespec start;
-	struct timespec remaining_timeout;
-	struct timespec *remaining_timeout_ptr = NULL;
+	event_reader reader;
 	clock_gettime(CLOCK_MONOTONIC, &start);
 	dbg_timespec("start", start);
-	if (timeout) {
-		remaining_timeout = *timeout;
-		remaining_timeout_ptr = &remaining_timeout;
+	rc = event_reader_init(&reader, self->line, &start, timeout);
+	if (rc) {
+		rc = -1;
+		goto release;
 	}
 
+	/* With neither waves nor a buffer size, count until the timeout */
 	if (waves == 0) {
 		waves = self->period_buf_size;
 	}
 	int events = waves * 2;
 
-	struct gpiod_line_event prev;
+	struct gpiod_line_event ev;
+	self->last_event.event_type = 0;
+	if (self->logger) {
+		gpiod_frequency_logger_break(self->logger);
+	}
+
+	if (self->rt) {
+		reader.latency = &self->latency;
+	}
+
+	rc = event_reader_skip(&reader, &start);
+	if (rc) {
+		goto end;
+	}
 
 	while (1) {
-		rc = read_event(self->line, &prev, remaining_timeout_ptr);
+		rc = read_event(&reader, &ev);
 		if (rc <= 0) {
 			goto end;
 		}
-		dbg_event("first event", prev);
-		if (timespec_gt(&prev.ts, &start)) {
+		dbg_event("first event", ev);
+		if (timespec_gt(&ev.ts, &start)) {
+			add_event(self, &ev);
 			break;
 		}
-		update_timeout(&start, timeout, remaining_timeout_ptr);
 	}
 
 	while (1) {
-		struct gpiod_line_event ev;
-		rc = read_event(self->line, &ev, remaining_timeout_ptr);
+		rc = read_event(&reader, &ev);
 		if (rc <= 0) {
 			goto end;
 		}
 		dbg_event("event", ev);
 
-		double period = timespec_diff_double(&prev.ts, &ev.ts);
-		int value = prev.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
-		prev = ev;
-		dbg("period: %d %.04lfs\n", value, period);
-
-		self->period_buf[value][self->period_buf_offset[value]] = period;
-		++self->period_buf_offset[value];
-		self->period_buf_offset[value] %= self->period_buf_size;
+		add_event(self, &ev);
 
 		if (--events == 0) {
 			rc = 0;
 			break;
 		}
-		update_timeout(&start, timeout, remaining_timeout_ptr);
 	}
 
 end:
+	event_reader_destroy(&reader);
+	gpiod_frequency_counter_update(self);
+release:
+	if (restore) {
+		rt_restore(&saved);
+	}
+	if (!persistent) {
+		gpiod_frequency_counter_release(self);
+	}
+	return rc;
+}
+
+EXPORT void gpiod_frequency_counter_add_event(
+	gpiod_frequency_counter *self,
+	const struct gpiod_line_event *ev
+) {
+	add_event(self, ev);
+}
+
+EXPORT void gpiod_frequency_counter_update(gpiod_frequency_counter *self) {
+	if (self->estimator == GPIOD_FREQUENCY_COUNTER_EMA) {
+		return;
+	}
 	for (int i = 0; i < 2; ++i) {
 		self->period[i] = get_period(
 			self->period_buf[i],
 			self->period_buf_size
 		);
 	}
-
-	gpiod_line_release(self->line);
-	return rc;
 }
 
 EXPORT double gpiod_frequency_counter_get_period(
@@ -187,6 +489,193 @@ EXPORT double gpiod_frequency_counter_get_duty_cycle(
 	return high / period;
 }
 
+static gpiod_frequency_counter_alarm *get_alarm(gpiod_frequency_counter *self) {
+	if (self->alarm) {
+		return self->alarm;
+	}
+	gpiod_frequency_counter_alarm *alarm = calloc(1, sizeof(*alarm));
+	if (!alarm) {
+		return NULL;
+	}
+	alarm->fd = -1;
+	self->alarm = alarm;
+	return alarm;
+}
+
+EXPORT int gpiod_frequency_counter_set_threshold(
+	gpiod_frequency_counter *self,
+	int quantity,
+	double low,
+	double high,
+	double hysteresis
+) {
+	if (quantity < 0 || quantity >= GPIOD_FREQUENCY_COUNTER_QUANTITIES
+	    || low > high || hysteresis < 0.0) {
+		errno = EINVAL;
+		return -1;
+	}
+	gpiod_frequency_counter_alarm *alarm = get_alarm(self);
+	if (!alarm) {
+		return -1;
+	}
+	gpiod_frequency_counter_threshold *th = &alarm->threshold[quantity];
+	th->low = low;
+	th->high = high;
+	th->hysteresis = hysteresis;
+	th->state = GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+	alarm->enabled |= 1 << quantity;
+	return 0;
+}
+
+EXPORT void gpiod_frequency_counter_clear_threshold(
+	gpiod_frequency_counter *self,
+	int quantity
+) {
+	if (self->alarm && quantity >= 0
+	    && quantity < GPIOD_FREQUENCY_COUNTER_QUANTITIES) {
+		self->alarm->enabled &= ~(1 << quantity);
+		self->alarm->threshold[quantity].state =
+			GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+	}
+}
+
+EXPORT int gpiod_frequency_counter_set_alarm_callback(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_counter_alarm_cb callback,
+	void *data
+) {
+	gpiod_frequency_counter_alarm *alarm = get_alarm(self);
+	if (!alarm) {
+		return -1;
+	}
+	alarm->callback = callback;
+	alarm->data = data;
+	return 0;
+}
+
+EXPORT int gpiod_frequency_counter_get_alarm_fd(gpiod_frequency_counter *self) {
+	gpiod_frequency_counter_alarm *alarm = get_alarm(self);
+	if (!alarm) {
+		return -1;
+	}
+	if (alarm->fd < 0) {
+		alarm->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (alarm->fd < 0) {
+			dbg("eventfd: %s\n", strerror(errno));
+		}
+	}
+	return alarm->fd;
+}
+
+EXPORT int gpiod_frequency_counter_get_alarm_state(
+	gpiod_frequency_counter *self,
+	int quantity
+) {
+	if (!self->alarm || quantity < 0
+	    || quantity >= GPIOD_FREQUENCY_COUNTER_QUANTITIES) {
+		return GPIOD_FREQUENCY_COUNTER_ALARM_NONE;
+	}
+	return self->alarm->threshold[quantity].state;
+}
+
+/*
+ * Switches to a per-edge exponential moving average with time constant
+ * tau in seconds of signal time, whatever the duty cycle: both half
+ * periods are averaged over about tau / period waves. tau <= 0 switches
+ * back to the buffer mean. Period
+ * getters reflect the average after every edge, so the counter may be
+ * created with buf_size 0 and read while counting.
+ */
+EXPORT int gpiod_frequency_counter_set_ema(
+	gpiod_frequency_counter *self,
+	double tau
+) {
+	if (isnan(tau)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (tau <= 0.0) {
+		if (!self->period_buf_size) {
+			errno = EINVAL;
+			return -1;
+		}
+		self->estimator = GPIOD_FREQUENCY_COUNTER_MEAN;
+		self->ema_tau = 0.0;
+		gpiod_frequency_counter_update(self);
+		return 0;
+	}
+	self->estimator = GPIOD_FREQUENCY_COUNTER_EMA;
+	self->ema_tau = tau;
+	return 0;
+}
+
+/*
+ * Statistics over the low (value = 0) or high (value = 1) period buffer.
+ */
+EXPORT void gpiod_frequency_counter_get_stats(
+	gpiod_frequency_counter *self,
+	int value,
+	gpiod_frequency_counter_stats *stats
+) {
+	period_sums sums;
+	get_period_sums(self->period_buf[value], self->period_buf_size, &sums);
+	stats->count = sums.count;
+	if (sums.count == 0) {
+		stats->mean = INFINITY;
+		stats->min = INFINITY;
+		stats->max = INFINITY;
+		stats->stddev = 0.0;
+		return;
+	}
+	stats->mean = sums.sum / sums.count;
+	stats->min = sums.min;
+	stats->max = sums.max;
+	double var = sums.sum_sq / sums.count - stats->mean * stats->mean;
+	stats->stddev = var > 0.0 ? sqrt(var) : 0.0;
+}
+
+/*
+ * The histogram is owned by the caller and receives one full period
+ * (rising edge to rising edge) per wave. It may be shared by counters
+ * that are run from the same thread.
+ */
+EXPORT void gpiod_frequency_counter_set_histogram(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_histogram *histogram
+) {
+	self->histogram = histogram;
+}
+
+/*
+ * The logger is owned by the caller and receives every edge passed to
+ * the counter.
+ */
+EXPORT void gpiod_frequency_counter_set_logger(
+	gpiod_frequency_counter *self,
+	gpiod_frequency_logger *logger
+) {
+	self->logger = logger;
+}
+
+/*
+ * Real-time options are applied to the thread calling count() for the
+ * duration of the call; its scheduling policy and affinity are restored
+ * afterwards, while memory stays locked. Wake-up latency is recorded
+ * while they are set.
+ */
+EXPORT void gpiod_frequency_counter_set_rt(
+	gpiod_frequency_counter *self,
+	const gpiod_frequency_rt *rt
+) {
+	self->rt = rt;
+}
+
+EXPORT const gpiod_frequency_latency *gpiod_frequency_counter_get_latency(
+	gpiod_frequency_counter *self
+) {
+	return &self->latency;
+}
+
 EXPORT const char* gpiod_frequency_counter_version_string() {
 	return VERSION_STR;
 }
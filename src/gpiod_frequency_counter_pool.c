@@ -0,0 +1,385 @@
+#include <util.h>
+#include <gpiod_frequency_counter_pool.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/*
+ * All per-line state is kept in structure-of-arrays form in a single
+ * allocation: 8-byte arrays first, then 4-byte, then 1-byte ones, so
+ * every array is naturally aligned. Period rings are laid out as
+ * period_buf[(2 * line + value) * buf_size + offset].
+ */
+EXPORT int gpiod_frequency_counter_pool_init(
+	gpiod_frequency_counter_pool *self,
+	struct gpiod_line **lines,
+	size_t size,
+	size_t buf_size,
+	const char *name,
+	int flags
+) {
+	memset(self, 0, sizeof(*self));
+	if (!buf_size) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!name) {
+		name = "gpiod_frequency_counter_pool";
+	}
+	size_t name_len = strlen(name);
+	size_t total = size * (
+		2 * sizeof(*self->period_sum)
+		+ 2 * buf_size * sizeof(*self->period_buf)
+		+ sizeof(*self->last_ts)
+		+ sizeof(*self->lines)
+		+ 2 * sizeof(*self->period_buf_offset)
+		+ 2 * sizeof(*self->period_buf_count)
+		+ sizeof(*self->pending)
+		+ sizeof(*self->fds)
+		+ sizeof(*self->last_value)
+	) + sizeof(*self->fds) + name_len + 1;
+	char *p = calloc(1, total);
+	if (!p) {
+		return -1;
+	}
+	self->storage = p;
+	self->size = size;
+	self->period_buf_size = buf_size;
+	self->flags = flags;
+
+	self->period_sum = (double*)p;
+	p += 2 * size * sizeof(*self->period_sum);
+	self->period_buf = (double*)p;
+	p += 2 * size * buf_size * sizeof(*self->period_buf);
+	self->last_ts = (int64_t*)p;
+	p += size * sizeof(*self->last_ts);
+	self->lines = (struct gpiod_line**)p;
+	p += size * sizeof(*self->lines);
+	self->period_buf_offset = (uint32_t*)p;
+	p += 2 * size * sizeof(*self->period_buf_offset);
+	self->period_buf_count = (uint32_t*)p;
+	p += 2 * size * sizeof(*self->period_buf_count);
+	self->pending = (int*)p;
+	p += size * sizeof(*self->pending);
+	self->fds = (struct pollfd*)p;
+	p += (size + 1) * sizeof(*self->fds);
+	self->last_value = (uint8_t*)p;
+	p += size * sizeof(*self->last_value);
+	self->name = p;
+
+	memcpy(self->name, name, name_len + 1);
+	memcpy(self->lines, lines, size * sizeof(*self->lines));
+	return 0;
+}
+
+EXPORT void gpiod_frequency_counter_pool_destroy(
+	gpiod_frequency_counter_pool *self
+) {
+	gpiod_frequency_counter_pool_release(self);
+	if (self->storage) {
+		free(self->storage);
+	}
+	memset(self, 0, sizeof(*self));
+}
+
+EXPORT void gpiod_frequency_counter_pool_reset(
+	gpiod_frequency_counter_pool *self
+) {
+	size_t size = self->size;
+	memset(self->period_sum, 0, 2 * size * sizeof(*self->period_sum));
+	memset(
+		self->period_buf,
+		0,
+		2 * size * self->period_buf_size * sizeof(*self->period_buf)
+	);
+	memset(self->last_ts, 0, size * sizeof(*self->last_ts));
+	memset(
+		self->period_buf_offset,
+		0,
+		2 * size * sizeof(*self->period_buf_offset)
+	);
+	memset(
+		self->period_buf_count,
+		0,
+		2 * size * sizeof(*self->period_buf_count)
+	);
+}
+
+EXPORT void gpiod_frequency_counter_pool_reset_line(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	size_t buf_size = self->period_buf_size;
+	memset(
+		self->period_buf + 2 * index * buf_size,
+		0,
+		2 * buf_size * sizeof(*self->period_buf)
+	);
+	for (size_t k = 2 * index; k < 2 * index + 2; ++k) {
+		self->period_sum[k] = 0.0;
+		self->period_buf_offset[k] = 0;
+		self->period_buf_count[k] = 0;
+	}
+	self->last_ts[index] = 0;
+}
+
+static inline void add_period(
+	gpiod_frequency_counter_pool *self,
+	size_t k,
+	double period
+) {
+	size_t buf_size = self->period_buf_size;
+	double *buf = self->period_buf + k * buf_size;
+	uint32_t offset = self->period_buf_offset[k];
+	self->period_sum[k] += period - buf[offset];
+	buf[offset] = period;
+	if (self->period_buf_count[k] < buf_size) {
+		++self->period_buf_count[k];
+	}
+	if (++offset == buf_size) {
+		/* Recompute the running sum once per ring to bound rounding drift */
+		double sum = 0.0;
+		for (size_t i = 0; i < buf_size; ++i) {
+			sum += buf[i];
+		}
+		self->period_sum[k] = sum;
+		offset = 0;
+	}
+	self->period_buf_offset[k] = offset;
+}
+
+EXPORT void gpiod_frequency_counter_pool_add_events(
+	gpiod_frequency_counter_pool *self,
+	size_t index,
+	const struct gpiod_line_event *events,
+	size_t count
+) {
+	int64_t last_ts = self->last_ts[index];
+	int value = self->last_value[index];
+	for (size_t i = 0; i < count; ++i) {
+		int64_t ts = timespec_to_ns(events[i].ts);
+		if (last_ts) {
+			add_period(self, 2 * index + value, 1e-9 * (ts - last_ts));
+		}
+		last_ts = ts;
+		value = events[i].event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+	}
+	self->last_ts[index] = last_ts;
+	self->last_value[index] = value;
+}
+
+static void release_lines(gpiod_frequency_counter_pool *self, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		gpiod_line_release(self->lines[i]);
+	}
+}
+
+/*
+ * Keeps all lines requested across count() calls until
+ * gpiod_frequency_counter_pool_release().
+ */
+EXPORT int gpiod_frequency_counter_pool_request(
+	gpiod_frequency_counter_pool *self
+) {
+	if (self->requested) {
+		return 0;
+	}
+	for (size_t i = 0; i < self->size; ++i) {
+		int rc = gpiod_line_request_both_edges_events_flags(
+			self->lines[i],
+			self->name,
+			self->flags
+		);
+		if (rc) {
+			dbg("gpiod_line_request_both_edges_events: %s\n", strerror(errno));
+			release_lines(self, i);
+			return -1;
+		}
+	}
+	self->requested = 1;
+	return 0;
+}
+
+EXPORT void gpiod_frequency_counter_pool_release(
+	gpiod_frequency_counter_pool *self
+) {
+	if (self->requested) {
+		release_lines(self, self->size);
+		self->requested = 0;
+	}
+}
+
+EXPORT int gpiod_frequency_counter_pool_count(
+	gpiod_frequency_counter_pool *self,
+	int waves,
+	const struct timespec *timeout
+) {
+	int rc = 0;
+	size_t size = self->size;
+	int persistent = self->requested;
+
+	if (gpiod_frequency_counter_pool_request(self)) {
+		return -1;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	dbg_timespec("start", start);
+
+	if (waves == 0) {
+		waves = self->period_buf_size;
+	}
+
+	size_t nfds = size;
+	size_t active = 0;
+	for (size_t i = 0; i < size; ++i) {
+		self->fds[i].fd = gpiod_line_event_get_fd(self->lines[i]);
+		self->fds[i].events = POLLIN | POLLPRI;
+		self->fds[i].revents = 0;
+		self->last_ts[i] = 0;
+		self->pending[i] = waves * 2;
+		if (self->fds[i].fd < 0) {
+			rc = -1;
+			goto end;
+		}
+		++active;
+	}
+	if (timeout) {
+		int fd = deadline_timer_create(&start, timeout);
+		if (fd < 0) {
+			rc = -1;
+			goto end;
+		}
+		self->fds[nfds].fd = fd;
+		self->fds[nfds].events = POLLIN;
+		self->fds[nfds].revents = 0;
+		++nfds;
+	}
+
+	int64_t start_ns = timespec_to_ns(start);
+	struct gpiod_line_event events[EVENT_BATCH_SIZE];
+
+	while (active) {
+		rc = poll(self->fds, nfds, -1);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			dbg("poll: %s\n", strerror(errno));
+			rc = -1;
+			break;
+		}
+		int ready = 0;
+		for (size_t i = 0; i < size; ++i) {
+			if (!self->fds[i].revents) {
+				continue;
+			}
+			ready = 1;
+			rc = gpiod_line_event_read_fd_multiple(
+				self->fds[i].fd,
+				events,
+				EVENT_BATCH_SIZE
+			);
+			if (rc < 0) {
+				dbg("gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+				goto end;
+			}
+			int skip = 0;
+			while (skip < rc && timespec_to_ns(events[skip].ts) <= start_ns) {
+				++skip;
+			}
+			int periods = rc - skip;
+			if (periods && !self->last_ts[i]) {
+				--periods;
+			}
+			gpiod_frequency_counter_pool_add_events(
+				self,
+				i,
+				events + skip,
+				rc - skip
+			);
+			self->pending[i] -= periods;
+			if (self->pending[i] <= 0) {
+				self->fds[i].fd = -1;
+				--active;
+			}
+		}
+		if (!ready && nfds > size && self->fds[size].revents) {
+			dbg("deadline expired\n");
+			break;
+		}
+	}
+	rc = rc < 0 ? -1 : 0;
+
+end:
+	if (nfds > size) {
+		close(self->fds[size].fd);
+	}
+	if (!persistent) {
+		gpiod_frequency_counter_pool_release(self);
+	}
+	return rc;
+}
+
+static double get_half_period(
+	gpiod_frequency_counter_pool *self,
+	size_t k
+) {
+	uint32_t count = self->period_buf_count[k];
+	if (count == 0) {
+		return INFINITY;
+	}
+	return self->period_sum[k] / count;
+}
+
+EXPORT double gpiod_frequency_counter_pool_get_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	return get_half_period(self, 2 * index)
+		+ get_half_period(self, 2 * index + 1);
+}
+
+EXPORT double gpiod_frequency_counter_pool_get_frequency(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	double period = gpiod_frequency_counter_pool_get_period(self, index);
+	if (period == INFINITY) {
+		return 0.0;
+	}
+	if (period == 0.0) {
+		return INFINITY;
+	}
+	return 1.0 / period;
+}
+
+EXPORT double gpiod_frequency_counter_pool_get_high_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	return get_half_period(self, 2 * index + 1);
+}
+
+EXPORT double gpiod_frequency_counter_pool_get_low_period(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	return get_half_period(self, 2 * index);
+}
+
+EXPORT double gpiod_frequency_counter_pool_get_duty_cycle(
+	gpiod_frequency_counter_pool *self,
+	size_t index
+) {
+	double period = gpiod_frequency_counter_pool_get_period(self, index);
+	if (period == 0.0 || period == INFINITY) {
+		return 1.0;
+	}
+	double high = gpiod_frequency_counter_pool_get_high_period(self, index);
+	return high / period;
+}
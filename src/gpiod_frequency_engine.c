@@ -0,0 +1,562 @@
+#include <util.h>
+#include <gpiod_frequency_engine.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*
+ * Every shard owns a counter pool, a poll set and a capture thread.
+ * Results are published per shard under a sequence lock: the worker
+ * reads every ready line and computes the new results first, then makes
+ * seq odd, stores them and makes seq even again, so seq is never held
+ * across a system call. Readers retry while seq is odd or has changed.
+ * Readers never write to shared memory, so any number of them can read
+ * without slowing down capture.
+ */
+
+#define DEFAULT_TIMEOUT 5.0
+
+static void publish_begin(gpiod_frequency_shard *self) {
+	uint32_t seq = self->seq;
+	__atomic_store_n(&self->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void publish_end(gpiod_frequency_shard *self) {
+	__atomic_store_n(&self->seq, self->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void compute(
+	gpiod_frequency_shard *self,
+	size_t local,
+	gpiod_frequency_engine_result *res
+) {
+	gpiod_frequency_counter_pool *pool = &self->pool;
+	res->frequency = gpiod_frequency_counter_pool_get_frequency(pool, local);
+	res->period = gpiod_frequency_counter_pool_get_period(pool, local);
+	res->duty_cycle = gpiod_frequency_counter_pool_get_duty_cycle(pool, local);
+}
+
+static void publish(
+	gpiod_frequency_shard *self,
+	size_t local,
+	const gpiod_frequency_engine_result *src
+) {
+	gpiod_frequency_engine_result *res = &self->results[local];
+	__atomic_store(&res->frequency, &src->frequency, __ATOMIC_RELAXED);
+	__atomic_store(&res->period, &src->period, __ATOMIC_RELAXED);
+	__atomic_store(&res->duty_cycle, &src->duty_cycle, __ATOMIC_RELAXED);
+	__atomic_store_n(&res->edges, src->edges, __ATOMIC_RELAXED);
+	__atomic_store_n(&res->last_ts, src->last_ts, __ATOMIC_RELAXED);
+}
+
+static int64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return timespec_to_ns(ts);
+}
+
+/*
+ * Poll timeout in ms until the first line that still has a result goes
+ * stale, or -1.
+ */
+static int stale_wait(
+	gpiod_frequency_shard *self,
+	const int64_t *last_read,
+	const char *stale,
+	int64_t now
+) {
+	int64_t next = -1;
+	for (size_t i = 0; i < self->pool.size; ++i) {
+		if (!stale[i] && (next < 0 || last_read[i] < next)) {
+			next = last_read[i];
+		}
+	}
+	if (!self->timeout || next < 0) {
+		return -1;
+	}
+	int64_t left = next + self->timeout - now;
+	return left > 0 ? (left + 999999) / 1000000 : 0;
+}
+
+static void read_result(
+	const gpiod_frequency_engine_result *src,
+	gpiod_frequency_engine_result *dst
+) {
+	__atomic_load(&src->frequency, &dst->frequency, __ATOMIC_RELAXED);
+	__atomic_load(&src->period, &dst->period, __ATOMIC_RELAXED);
+	__atomic_load(&src->duty_cycle, &dst->duty_cycle, __ATOMIC_RELAXED);
+	dst->edges = __atomic_load_n(&src->edges, __ATOMIC_RELAXED);
+	dst->last_ts = __atomic_load_n(&src->last_ts, __ATOMIC_RELAXED);
+}
+
+static uint32_t read_begin(gpiod_frequency_shard *self) {
+	uint32_t seq;
+	while ((seq = __atomic_load_n(&self->seq, __ATOMIC_ACQUIRE)) & 1) {
+		/* the writer holds it for a few stores only */
+	}
+	return seq;
+}
+
+static int read_retry(gpiod_frequency_shard *self, uint32_t seq) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&self->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+ * A line without edges for the timeout is reset and published as
+ * having no signal, so the gap is not counted as a period either.
+ */
+static void *capture(void *data) {
+	gpiod_frequency_shard *self = data;
+	gpiod_frequency_counter_pool *pool = &self->pool;
+	size_t size = pool->size;
+	struct gpiod_line_event events[EVENT_BATCH_SIZE];
+	gpiod_frequency_engine_result *pending = NULL;
+	size_t *touched = NULL;
+	int64_t *last_read = NULL;
+	char *stale = NULL;
+
+	if (self->rt) {
+		gpiod_frequency_rt rt = *self->rt;
+		if (rt.cpu >= 0) {
+			rt.cpu += self->id;
+		}
+		if (gpiod_frequency_rt_apply(&rt)) {
+			__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			return NULL;
+		}
+	}
+
+	pending = calloc(size ? size : 1, sizeof(*pending));
+	touched = calloc(size ? size : 1, sizeof(*touched));
+	last_read = calloc(size ? size : 1, sizeof(*last_read));
+	stale = malloc(size ? size : 1);
+	if (!pending || !touched || !last_read || !stale) {
+		__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+		goto end;
+	}
+	/* results of a previous run are cleared until the first edges */
+	publish_begin(self);
+	for (size_t i = 0; i < size; ++i) {
+		pending[i] = self->results[i];
+		compute(self, i, &pending[i]);
+		publish(self, i, &pending[i]);
+		stale[i] = 1;
+	}
+	publish_end(self);
+
+	int64_t now = now_ns();
+	while (1) {
+		int rc = poll(self->fds, size + 1, stale_wait(self, last_read, stale, now));
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			dbg("poll: %s\n", strerror(errno));
+			__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			break;
+		}
+		if (self->fds[size].revents) {
+			break;
+		}
+		now = now_ns();
+		size_t count = 0;
+		for (size_t i = 0; i < size; ++i) {
+			if (!self->fds[i].revents) {
+				continue;
+			}
+			rc = gpiod_line_event_read_fd_multiple(
+				self->fds[i].fd,
+				events,
+				EVENT_BATCH_SIZE
+			);
+			if (rc <= 0) {
+				if (rc < 0) {
+					dbg("gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+					__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+					/* stays readable, so it is no longer polled */
+					self->fds[i].fd = -1;
+				}
+				continue;
+			}
+			gpiod_frequency_counter_pool_add_events(pool, i, events, rc);
+			pending[i].edges += rc;
+			pending[i].last_ts = pool->last_ts[i];
+			compute(self, i, &pending[i]);
+			last_read[i] = now;
+			stale[i] = 0;
+			touched[count++] = i;
+		}
+		for (size_t i = 0; self->timeout && i < size; ++i) {
+			if (!stale[i] && now - last_read[i] >= self->timeout) {
+				gpiod_frequency_counter_pool_reset_line(pool, i);
+				compute(self, i, &pending[i]);
+				stale[i] = 1;
+				touched[count++] = i;
+			}
+		}
+		if (!count) {
+			continue;
+		}
+		publish_begin(self);
+		for (size_t k = 0; k < count; ++k) {
+			publish(self, touched[k], &pending[touched[k]]);
+		}
+		publish_end(self);
+	}
+end:
+	free(pending);
+	free(touched);
+	free(last_read);
+	free(stale);
+	return NULL;
+}
+
+static void destroy_shard(gpiod_frequency_shard *self) {
+	gpiod_frequency_counter_pool_destroy(&self->pool);
+	free(self->results);
+	free(self->index);
+	free(self->fds);
+	self->results = NULL;
+	self->index = NULL;
+	self->fds = NULL;
+}
+
+/*
+ * Lines are grouped by chip and the groups are assigned to the least
+ * loaded of the given number of threads. With fewer chips than
+ * threads, lines are assigned one by one instead.
+ */
+static int assign(
+	gpiod_frequency_engine *self,
+	struct gpiod_line **lines,
+	size_t size,
+	size_t threads
+) {
+	struct gpiod_chip **chips = calloc(size ? size : 1, sizeof(*chips));
+	size_t *load = calloc(threads, sizeof(*load));
+	size_t chip_count = 0;
+	if (!chips || !load) {
+		free(chips);
+		free(load);
+		return -1;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		struct gpiod_chip *chip = gpiod_line_get_chip(lines[i]);
+		size_t j = 0;
+		while (j < chip_count && chips[j] != chip) {
+			++j;
+		}
+		if (j == chip_count) {
+			chips[chip_count++] = chip;
+		}
+	}
+	int by_chip = chip_count >= threads;
+	size_t groups = by_chip ? chip_count : size;
+	for (size_t g = 0; g < groups; ++g) {
+		size_t best = 0;
+		for (size_t t = 1; t < threads; ++t) {
+			if (load[t] < load[best]) {
+				best = t;
+			}
+		}
+		for (size_t i = 0; i < size; ++i) {
+			int member = by_chip
+				? gpiod_line_get_chip(lines[i]) == chips[g]
+				: i == g;
+			if (member) {
+				self->shard_of[i] = best;
+				++load[best];
+			}
+		}
+	}
+	free(chips);
+	free(load);
+	return 0;
+}
+
+/*
+ * Splits the lines into at most threads shards. Capture starts with
+ * gpiod_frequency_engine_start().
+ */
+EXPORT int gpiod_frequency_engine_init(
+	gpiod_frequency_engine *self,
+	struct gpiod_line **lines,
+	size_t size,
+	size_t threads,
+	size_t buf_size,
+	const char *name,
+	int flags
+) {
+	memset(self, 0, sizeof(*self));
+	self->stop_fd = -1;
+	self->timeout = llround(DEFAULT_TIMEOUT * 1e9);
+	if (!threads || !buf_size) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (threads > size) {
+		threads = size ? size : 1;
+	}
+	self->size = size;
+	self->shard_of = calloc(size ? size : 1, sizeof(*self->shard_of));
+	self->local_of = calloc(size ? size : 1, sizeof(*self->local_of));
+	if (!self->shard_of || !self->local_of) {
+		goto error;
+	}
+	if (assign(self, lines, size, threads)) {
+		goto error;
+	}
+	void *shards;
+	int rc = posix_memalign(&shards, 64, threads * sizeof(*self->shards));
+	if (rc) {
+		errno = rc;
+		goto error;
+	}
+	memset(shards, 0, threads * sizeof(*self->shards));
+	self->shards = shards;
+	self->shard_count = threads;
+
+	struct gpiod_line **shard_lines = calloc(size ? size : 1, sizeof(*shard_lines));
+	if (!shard_lines) {
+		goto error;
+	}
+	for (size_t s = 0; s < threads; ++s) {
+		gpiod_frequency_shard *shard = &self->shards[s];
+		size_t count = 0;
+		for (size_t i = 0; i < size; ++i) {
+			if (self->shard_of[i] == s) {
+				self->local_of[i] = count;
+				shard_lines[count++] = lines[i];
+			}
+		}
+		shard->id = s;
+		shard->stop_fd = -1;
+		shard->index = calloc(count ? count : 1, sizeof(*shard->index));
+		shard->results = calloc(count ? count : 1, sizeof(*shard->results));
+		shard->fds = calloc(count + 1, sizeof(*shard->fds));
+		if (!shard->index || !shard->results || !shard->fds) {
+			free(shard_lines);
+			goto error;
+		}
+		for (size_t i = 0; i < size; ++i) {
+			if (self->shard_of[i] == s) {
+				shard->index[self->local_of[i]] = i;
+			}
+		}
+		if (gpiod_frequency_counter_pool_init(
+			&shard->pool,
+			shard_lines,
+			count,
+			buf_size,
+			name ? name : "gpiod_frequency_engine",
+			flags
+		)) {
+			free(shard_lines);
+			goto error;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			shard->results[i].period = INFINITY;
+			shard->results[i].duty_cycle = 1.0;
+		}
+	}
+	free(shard_lines);
+	return 0;
+error:
+	gpiod_frequency_engine_destroy(self);
+	return -1;
+}
+
+EXPORT void gpiod_frequency_engine_destroy(gpiod_frequency_engine *self) {
+	if (self->running) {
+		gpiod_frequency_engine_stop(self);
+	}
+	if (self->shards) {
+		for (size_t s = 0; s < self->shard_count; ++s) {
+			destroy_shard(&self->shards[s]);
+		}
+		free(self->shards);
+		self->shards = NULL;
+	}
+	free(self->shard_of);
+	free(self->local_of);
+	self->shard_of = NULL;
+	self->local_of = NULL;
+	self->shard_count = 0;
+	self->size = 0;
+}
+
+/*
+ * Real-time options are applied to every capture thread when it starts.
+ * If a cpu is set, shard n is pinned to cpu + n.
+ */
+EXPORT void gpiod_frequency_engine_set_rt(
+	gpiod_frequency_engine *self,
+	const gpiod_frequency_rt *rt
+) {
+	self->rt = rt;
+}
+
+/*
+ * Lines without edges for timeout seconds (5 by default) report no
+ * signal until their next edges; 0 disables the timeout. Takes effect
+ * on the next start.
+ */
+EXPORT int gpiod_frequency_engine_set_timeout(
+	gpiod_frequency_engine *self,
+	double timeout
+) {
+	if (!(timeout >= 0.0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	self->timeout = llround(timeout * 1e9);
+	return 0;
+}
+
+EXPORT int gpiod_frequency_engine_start(gpiod_frequency_engine *self) {
+	size_t started = 0;
+	if (self->running) {
+		errno = EBUSY;
+		return -1;
+	}
+	self->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (self->stop_fd < 0) {
+		dbg("eventfd: %s\n", strerror(errno));
+		return -1;
+	}
+	for (size_t s = 0; s < self->shard_count; ++s) {
+		gpiod_frequency_shard *shard = &self->shards[s];
+		size_t size = shard->pool.size;
+		if (gpiod_frequency_counter_pool_request(&shard->pool)) {
+			goto error;
+		}
+		gpiod_frequency_counter_pool_reset(&shard->pool);
+		for (size_t i = 0; i < size; ++i) {
+			shard->fds[i].fd = gpiod_line_event_get_fd(shard->pool.lines[i]);
+			shard->fds[i].events = POLLIN | POLLPRI;
+			if (shard->fds[i].fd < 0) {
+				dbg("gpiod_line_event_get_fd: %s\n", strerror(errno));
+				gpiod_frequency_counter_pool_release(&shard->pool);
+				goto error;
+			}
+		}
+		/* the stop eventfd is never read, so it wakes up every shard */
+		shard->fds[size].fd = self->stop_fd;
+		shard->fds[size].events = POLLIN;
+		shard->stop_fd = self->stop_fd;
+		shard->rt = self->rt;
+		shard->timeout = self->timeout;
+		shard->error = 0;
+		int rc = pthread_create(&shard->thread, NULL, capture, shard);
+		if (rc) {
+			errno = rc;
+			dbg("pthread_create: %s\n", strerror(errno));
+			gpiod_frequency_counter_pool_release(&shard->pool);
+			goto error;
+		}
+		shard->running = 1;
+		++started;
+	}
+	self->running = 1;
+	return 0;
+error:
+	self->running = started > 0;
+	if (self->running) {
+		int err = errno;
+		gpiod_frequency_engine_stop(self);
+		errno = err;
+	} else {
+		close(self->stop_fd);
+		self->stop_fd = -1;
+	}
+	return -1;
+}
+
+EXPORT int gpiod_frequency_engine_stop(gpiod_frequency_engine *self) {
+	if (!self->running) {
+		errno = EINVAL;
+		return -1;
+	}
+	uint64_t one = 1;
+	if (write(self->stop_fd, &one, sizeof(one)) < 0) {
+		dbg("write: %s\n", strerror(errno));
+		return -1;
+	}
+	for (size_t s = 0; s < self->shard_count; ++s) {
+		gpiod_frequency_shard *shard = &self->shards[s];
+		if (!shard->running) {
+			continue;
+		}
+		pthread_join(shard->thread, NULL);
+		gpiod_frequency_counter_pool_release(&shard->pool);
+		shard->stop_fd = -1;
+		shard->running = 0;
+	}
+	close(self->stop_fd);
+	self->stop_fd = -1;
+	self->running = 0;
+	return 0;
+}
+
+EXPORT size_t gpiod_frequency_engine_get_shard(
+	gpiod_frequency_engine *self,
+	size_t index
+) {
+	return self->shard_of[index];
+}
+
+EXPORT void gpiod_frequency_engine_get_result(
+	gpiod_frequency_engine *self,
+	size_t index,
+	gpiod_frequency_engine_result *res
+) {
+	gpiod_frequency_shard *shard = &self->shards[self->shard_of[index]];
+	const gpiod_frequency_engine_result *src =
+		&shard->results[self->local_of[index]];
+	uint32_t seq;
+	do {
+		seq = read_begin(shard);
+		read_result(src, res);
+	} while (read_retry(shard, seq));
+}
+
+/*
+ * Results of the lines of each shard are read as one consistent
+ * snapshot; res must have room for all lines.
+ */
+EXPORT void gpiod_frequency_engine_get_results(
+	gpiod_frequency_engine *self,
+	gpiod_frequency_engine_result *res
+) {
+	for (size_t s = 0; s < self->shard_count; ++s) {
+		gpiod_frequency_shard *shard = &self->shards[s];
+		size_t size = shard->pool.size;
+		uint32_t seq;
+		do {
+			seq = read_begin(shard);
+			for (size_t i = 0; i < size; ++i) {
+				read_result(&shard->results[i], &res[shard->index[i]]);
+			}
+		} while (read_retry(shard, seq));
+	}
+}
+
+/*
+ * Returns the first capture error of any shard, or 0.
+ */
+EXPORT int gpiod_frequency_engine_get_error(gpiod_frequency_engine *self) {
+	for (size_t s = 0; s < self->shard_count; ++s) {
+		int err = __atomic_load_n(&self->shards[s].error, __ATOMIC_RELAXED);
+		if (err) {
+			return err;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include <util.h>
+#include <gpiod_frequency_histogram.h>
+
+#include <math.h>
+#include <string.h>
+
+EXPORT void gpiod_frequency_histogram_reset(gpiod_frequency_histogram *self) {
+	memset(self, 0, sizeof(*self));
+}
+
+EXPORT void gpiod_frequency_histogram_merge(
+	gpiod_frequency_histogram *self,
+	const gpiod_frequency_histogram *other
+) {
+	for (size_t i = 0; i < GPIOD_FREQUENCY_HISTOGRAM_BINS; ++i) {
+		self->bins[i] += other->bins[i];
+	}
+	self->count += other->count;
+}
+
+EXPORT uint64_t gpiod_frequency_histogram_get_bin_lower(size_t index) {
+	const int sub_bits = GPIOD_FREQUENCY_HISTOGRAM_SUB_BITS;
+	if (index < (1u << sub_bits)) {
+		return index;
+	}
+	int shift = (index >> sub_bits) - 1;
+	uint64_t sub = index & ((1u << sub_bits) - 1);
+	return ((1ull << sub_bits) + sub) << shift;
+}
+
+EXPORT uint64_t gpiod_frequency_histogram_get_bin_upper(size_t index) {
+	if (index >= GPIOD_FREQUENCY_HISTOGRAM_BINS - 1) {
+		return UINT64_MAX;
+	}
+	return gpiod_frequency_histogram_get_bin_lower(index + 1);
+}
+
+/*
+ * Returns the midpoint of the bin holding the given percentile (0-100)
+ * in seconds, or NAN if the histogram is empty.
+ */
+EXPORT double gpiod_frequency_histogram_get_percentile(
+	const gpiod_frequency_histogram *self,
+	double percentile
+) {
+	if (!self->count) {
+		return NAN;
+	}
+	uint64_t rank = ceil(percentile / 100.0 * self->count);
+	if (rank < 1) {
+		rank = 1;
+	}
+	uint64_t total = 0;
+	size_t i;
+	for (i = 0; i < GPIOD_FREQUENCY_HISTOGRAM_BINS - 1; ++i) {
+		total += self->bins[i];
+		if (total >= rank) {
+			break;
+		}
+	}
+	uint64_t lower = gpiod_frequency_histogram_get_bin_lower(i);
+	uint64_t upper = gpiod_frequency_histogram_get_bin_upper(i);
+	if (upper == UINT64_MAX) {
+		return 1e-9 * lower;
+	}
+	return 1e-9 * (lower + upper) / 2.0;
+}
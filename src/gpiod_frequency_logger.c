@@ -0,0 +1,411 @@
+#include <util.h>
+#include <gpiod_frequency_logger.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*
+ * Records are produced by the capture thread into a single-producer,
+ * single-consumer ring and written to the file by a background thread,
+ * so a slow disk never blocks capture: when the ring is full the record
+ * is dropped and counted instead.
+ */
+
+static void reset_interval(gpiod_frequency_logger *self) {
+	self->edges = 0;
+	self->waves = 0;
+	self->frequency_sum = 0.0;
+	self->frequency_sum_sq = 0.0;
+	self->frequency_min = INFINITY;
+	self->frequency_max = -INFINITY;
+	self->duty_cycle_sum = 0.0;
+	self->duty_cycle_sum_sq = 0.0;
+	self->duty_cycle_min = INFINITY;
+	self->duty_cycle_max = -INFINITY;
+}
+
+static void set_stats(
+	float *res,
+	uint32_t count,
+	double sum,
+	double sum_sq,
+	double min,
+	double max
+) {
+	if (!count) {
+		for (int i = 0; i < GPIOD_FREQUENCY_RECORD_STATS; ++i) {
+			res[i] = NAN;
+		}
+		return;
+	}
+	double mean = sum / count;
+	double var = sum_sq / count - mean * mean;
+	res[GPIOD_FREQUENCY_RECORD_MEAN] = mean;
+	res[GPIOD_FREQUENCY_RECORD_MIN] = min;
+	res[GPIOD_FREQUENCY_RECORD_MAX] = max;
+	res[GPIOD_FREQUENCY_RECORD_STDDEV] = var > 0.0 ? sqrt(var) : 0.0;
+}
+
+static void emit(gpiod_frequency_logger *self) {
+	uint64_t head = self->head;
+	uint64_t tail = __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= self->ring_size) {
+		__atomic_store_n(&self->dropped, self->dropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+	gpiod_frequency_record *rec = &self->ring[head & (self->ring_size - 1)];
+	rec->start = self->start;
+	rec->index = self->index;
+	rec->edges = self->edges;
+	set_stats(
+		rec->frequency,
+		self->waves,
+		self->frequency_sum,
+		self->frequency_sum_sq,
+		self->frequency_min,
+		self->frequency_max
+	);
+	set_stats(
+		rec->duty_cycle,
+		self->waves,
+		self->duty_cycle_sum,
+		self->duty_cycle_sum_sq,
+		self->duty_cycle_min,
+		self->duty_cycle_max
+	);
+	__atomic_store_n(&self->head, head + 1, __ATOMIC_RELEASE);
+	uint64_t one = 1;
+	if (write(self->wake_fd, &one, sizeof(one)) < 0) {
+		dbg("write: %s\n", strerror(errno));
+	}
+}
+
+/*
+ * Closes the current interval if ts is past its end. Intervals without
+ * edges are not written.
+ */
+static void advance(gpiod_frequency_logger *self, int64_t ts) {
+	if (!self->start || ts < self->start + self->interval) {
+		return;
+	}
+	if (self->edges) {
+		emit(self);
+	}
+	reset_interval(self);
+	self->start = ts - ts % self->interval;
+}
+
+static int write_all(int fd, const void *buf, size_t size, off_t offset) {
+	const char *p = buf;
+	while (size) {
+		ssize_t rc = offset < 0
+			? write(fd, p, size)
+			: pwrite(fd, p, size, offset);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		p += rc;
+		size -= rc;
+		if (offset >= 0) {
+			offset += rc;
+		}
+	}
+	return 0;
+}
+
+static int write_records(
+	gpiod_frequency_logger *self,
+	const gpiod_frequency_record *recs,
+	size_t count
+) {
+	if (!self->max_records) {
+		if (write_all(self->fd, recs, count * sizeof(*recs), -1)) {
+			return -1;
+		}
+		__atomic_store_n(&self->written, self->written + count, __ATOMIC_RELAXED);
+		return 0;
+	}
+	while (count) {
+		size_t slot = self->written % self->max_records;
+		size_t n = self->max_records - slot;
+		if (n > count) {
+			n = count;
+		}
+		off_t offset = sizeof(gpiod_frequency_log_header) + slot * sizeof(*recs);
+		if (write_all(self->fd, recs, n * sizeof(*recs), offset)) {
+			return -1;
+		}
+		__atomic_store_n(&self->written, self->written + n, __ATOMIC_RELAXED);
+		recs += n;
+		count -= n;
+	}
+	return 0;
+}
+
+static void *writer(void *data) {
+	gpiod_frequency_logger *self = data;
+	while (1) {
+		uint64_t value;
+		if (read(self->wake_fd, &value, sizeof(value)) < 0 && errno != EINTR) {
+			dbg("read: %s\n", strerror(errno));
+			__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			break;
+		}
+		int stop = __atomic_load_n(&self->stop, __ATOMIC_ACQUIRE);
+		uint64_t tail = self->tail;
+		uint64_t head = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+		while (tail != head) {
+			size_t offset = tail & (self->ring_size - 1);
+			size_t count = head - tail;
+			if (count > self->ring_size - offset) {
+				count = self->ring_size - offset;
+			}
+			if (write_records(self, self->ring + offset, count)) {
+				/* the records are lost, get_written() does not count them */
+				dbg("write: %s\n", strerror(errno));
+				__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			}
+			tail += count;
+			__atomic_store_n(&self->tail, tail, __ATOMIC_RELEASE);
+		}
+		if (stop) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int open_log(
+	gpiod_frequency_logger *self,
+	const char *path,
+	size_t max_records
+) {
+	int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+	flags |= max_records ? O_TRUNC : O_APPEND;
+	self->fd = open(path, flags, 0644);
+	if (self->fd < 0) {
+		dbg("open: %s\n", strerror(errno));
+		return -1;
+	}
+	struct timespec mono, real;
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	clock_gettime(CLOCK_REALTIME, &real);
+	int64_t realtime_offset = timespec_to_ns(real) - timespec_to_ns(mono);
+	gpiod_frequency_record session = {
+		.start = realtime_offset,
+		.index = GPIOD_FREQUENCY_LOG_SESSION,
+	};
+	off_t size = lseek(self->fd, 0, SEEK_END);
+	if (size < 0) {
+		return -1;
+	}
+	if (size > 0) {
+		gpiod_frequency_log_header header;
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return -1;
+		}
+		ssize_t rc = read(fd, &header, sizeof(header));
+		close(fd);
+		if (rc != sizeof(header)
+		    || header.magic != GPIOD_FREQUENCY_LOG_MAGIC
+		    || header.version != GPIOD_FREQUENCY_LOG_VERSION
+		    || header.record_size != sizeof(gpiod_frequency_record)
+		    || header.interval != self->interval
+		    || header.max_records != 0
+		    || (size - sizeof(header)) % sizeof(gpiod_frequency_record)) {
+			errno = EINVAL;
+			return -1;
+		}
+		return write_all(self->fd, &session, sizeof(session), -1);
+	}
+	gpiod_frequency_log_header header = {
+		.magic = GPIOD_FREQUENCY_LOG_MAGIC,
+		.version = GPIOD_FREQUENCY_LOG_VERSION,
+		.record_size = sizeof(gpiod_frequency_record),
+		.interval = self->interval,
+		.realtime_offset = realtime_offset,
+		.max_records = max_records,
+		.reserved = 0,
+	};
+	if (write_all(self->fd, &header, sizeof(header), -1)) {
+		return -1;
+	}
+	if (!max_records) {
+		return write_all(self->fd, &session, sizeof(session), -1);
+	}
+	return 0;
+}
+
+/*
+ * Aggregates edges into fixed intervals of the given length in seconds
+ * and writes one record per non-empty interval to path. With
+ * max_records = 0 records are appended to the file after a session
+ * marker, otherwise the file is truncated and reused as a ring of
+ * max_records records. ring_size
+ * is the number of records buffered in memory (rounded up to a power
+ * of two).
+ */
+EXPORT int gpiod_frequency_logger_init(
+	gpiod_frequency_logger *self,
+	const char *path,
+	double interval,
+	size_t ring_size,
+	size_t max_records,
+	uint32_t index
+) {
+	memset(self, 0, sizeof(*self));
+	self->fd = -1;
+	self->wake_fd = -1;
+	if (!(interval > 0.0) || !ring_size || max_records > UINT32_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	self->interval = llround(interval * 1e9);
+	self->index = index;
+	self->max_records = max_records;
+	self->ring_size = 1;
+	while (self->ring_size < ring_size) {
+		self->ring_size <<= 1;
+	}
+	reset_interval(self);
+
+	self->ring = calloc(self->ring_size, sizeof(*self->ring));
+	if (!self->ring) {
+		goto error;
+	}
+	if (open_log(self, path, max_records)) {
+		goto error;
+	}
+	self->wake_fd = eventfd(0, EFD_CLOEXEC);
+	if (self->wake_fd < 0) {
+		dbg("eventfd: %s\n", strerror(errno));
+		goto error;
+	}
+	int rc = pthread_create(&self->thread, NULL, writer, self);
+	if (rc) {
+		errno = rc;
+		dbg("pthread_create: %s\n", strerror(errno));
+		goto error;
+	}
+	self->running = 1;
+	return 0;
+error:
+	gpiod_frequency_logger_destroy(self);
+	return -1;
+}
+
+/*
+ * Writes the current, possibly partial interval and waits for the
+ * writer to drain the ring.
+ */
+EXPORT void gpiod_frequency_logger_destroy(gpiod_frequency_logger *self) {
+	if (self->running) {
+		if (self->edges) {
+			emit(self);
+			reset_interval(self);
+		}
+		__atomic_store_n(&self->stop, 1, __ATOMIC_RELEASE);
+		uint64_t one = 1;
+		if (write(self->wake_fd, &one, sizeof(one)) < 0) {
+			dbg("write: %s\n", strerror(errno));
+		}
+		pthread_join(self->thread, NULL);
+		self->running = 0;
+	}
+	if (self->wake_fd >= 0) {
+		close(self->wake_fd);
+		self->wake_fd = -1;
+	}
+	if (self->fd >= 0) {
+		close(self->fd);
+		self->fd = -1;
+	}
+	if (self->ring) {
+		free(self->ring);
+		self->ring = NULL;
+	}
+}
+
+/*
+ * One frequency and duty cycle sample is taken per wave, from rising
+ * edge to rising edge, and counted in the interval where it ends.
+ */
+EXPORT void gpiod_frequency_logger_add_event(
+	gpiod_frequency_logger *self,
+	const struct gpiod_line_event *ev
+) {
+	int64_t ts = timespec_to_ns(ev->ts);
+	if (!self->start) {
+		self->start = ts - ts % self->interval;
+	}
+	advance(self, ts);
+	++self->edges;
+	if (ev->event_type != GPIOD_LINE_EVENT_RISING_EDGE) {
+		self->last_fall = ts;
+		return;
+	}
+	if (self->last_rise && self->last_fall > self->last_rise && ts > self->last_rise) {
+		double period = 1e-9 * (ts - self->last_rise);
+		double frequency = 1.0 / period;
+		double duty_cycle = 1e-9 * (self->last_fall - self->last_rise) / period;
+		++self->waves;
+		self->frequency_sum += frequency;
+		self->frequency_sum_sq += frequency * frequency;
+		self->frequency_min = fmin(self->frequency_min, frequency);
+		self->frequency_max = fmax(self->frequency_max, frequency);
+		self->duty_cycle_sum += duty_cycle;
+		self->duty_cycle_sum_sq += duty_cycle * duty_cycle;
+		self->duty_cycle_min = fmin(self->duty_cycle_min, duty_cycle);
+		self->duty_cycle_max = fmax(self->duty_cycle_max, duty_cycle);
+	}
+	self->last_rise = ts;
+}
+
+/*
+ * Forgets the last edges, so that no wave is taken across a gap in the
+ * events, such as between two count() windows. The interval goes on.
+ */
+EXPORT void gpiod_frequency_logger_break(gpiod_frequency_logger *self) {
+	self->last_rise = 0;
+	self->last_fall = 0;
+}
+
+/*
+ * Closes the current interval once now (in the event clock) is past
+ * its end, so records are written while the input is idle.
+ */
+EXPORT void gpiod_frequency_logger_flush(
+	gpiod_frequency_logger *self,
+	const struct timespec *now
+) {
+	advance(self, timespec_to_ns(*now));
+}
+
+/*
+ * Records written to the file, not counting session markers. Records
+ * that failed to be written are not counted, see get_error().
+ */
+EXPORT uint64_t gpiod_frequency_logger_get_written(
+	gpiod_frequency_logger *self
+) {
+	return __atomic_load_n(&self->written, __ATOMIC_RELAXED);
+}
+
+EXPORT uint64_t gpiod_frequency_logger_get_dropped(
+	gpiod_frequency_logger *self
+) {
+	return __atomic_load_n(&self->dropped, __ATOMIC_RELAXED);
+}
+
+EXPORT int gpiod_frequency_logger_get_error(gpiod_frequency_logger *self) {
+	return __atomic_load_n(&self->error, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,328 @@
+#include <util.h>
+#include <gpiod_frequency_phase.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+EXPORT int gpiod_frequency_phase_init(
+	gpiod_frequency_phase *self,
+	struct gpiod_line *reference,
+	struct gpiod_line *line,
+	size_t buf_size,
+	const char *name,
+	int flags
+) {
+	memset(self, 0, sizeof(*self));
+	self->skew = NAN;
+	if (!buf_size) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!name) {
+		name = "gpiod_frequency_phase";
+	}
+	struct gpiod_line *lines[2] = { reference, line };
+	for (int i = 0; i < 2; ++i) {
+		if (gpiod_frequency_counter_init(
+			&self->counter[i],
+			lines[i],
+			buf_size,
+			name,
+			flags
+		)) {
+			goto error;
+		}
+	}
+	self->phase_buf_size = buf_size;
+	self->phase_buf = malloc(buf_size * sizeof(*self->phase_buf));
+	if (!self->phase_buf) {
+		goto error;
+	}
+	for (size_t i = 0; i < buf_size; ++i) {
+		self->phase_buf[i] = NAN;
+	}
+	return 0;
+error:
+	gpiod_frequency_phase_destroy(self);
+	return -1;
+}
+
+EXPORT void gpiod_frequency_phase_destroy(gpiod_frequency_phase *self) {
+	for (int i = 0; i < 2; ++i) {
+		gpiod_frequency_counter_destroy(&self->counter[i]);
+	}
+	if (self->phase_buf) {
+		free(self->phase_buf);
+		self->phase_buf = NULL;
+	}
+}
+
+EXPORT void gpiod_frequency_phase_reset(gpiod_frequency_phase *self) {
+	for (int i = 0; i < 2; ++i) {
+		gpiod_frequency_counter_reset(&self->counter[i]);
+	}
+	for (size_t i = 0; i < self->phase_buf_size; ++i) {
+		self->phase_buf[i] = NAN;
+	}
+	self->phase_buf_offset = 0;
+	self->skew = NAN;
+	self->has_rising = 0;
+}
+
+/*
+ * Each rising edge of the second line adds the phase angle of its skew
+ * from the last rising edge of the reference line, in radians of the
+ * last reference period.
+ */
+EXPORT void gpiod_frequency_phase_add_event(
+	gpiod_frequency_phase *self,
+	int index,
+	const struct gpiod_line_event *ev
+) {
+	gpiod_frequency_counter_add_event(&self->counter[index], ev);
+	if (ev->event_type != GPIOD_LINE_EVENT_RISING_EDGE) {
+		return;
+	}
+	if (index == 0) {
+		self->last_rising = ev->ts;
+		self->has_rising = 1;
+		return;
+	}
+	if (!self->has_rising) {
+		return;
+	}
+	double *last_period = self->counter[0].last_period;
+	double period = last_period[0] + last_period[1];
+	if (!(last_period[0] > 0.0 && last_period[1] > 0.0)) {
+		return;
+	}
+	double skew = timespec_diff_double(&self->last_rising, &ev->ts);
+	dbg("skew: %.06lfs\n", skew);
+	self->phase_buf[self->phase_buf_offset] = 2.0 * M_PI * skew / period;
+	++self->phase_buf_offset;
+	self->phase_buf_offset %= self->phase_buf_size;
+}
+
+EXPORT void gpiod_frequency_phase_update(gpiod_frequency_phase *self) {
+	for (int i = 0; i < 2; ++i) {
+		gpiod_frequency_counter_update(&self->counter[i]);
+	}
+	/*
+	 * Circular mean, so that samples on both sides of +-180 degrees do
+	 * not average to 0.
+	 */
+	double sum_sin = 0.0;
+	double sum_cos = 0.0;
+	int count = 0;
+	for (size_t i = 0; i < self->phase_buf_size; ++i) {
+		if (!isnan(self->phase_buf[i])) {
+			sum_sin += sin(self->phase_buf[i]);
+			sum_cos += cos(self->phase_buf[i]);
+			++count;
+		}
+	}
+	double period = gpiod_frequency_counter_get_period(&self->counter[0]);
+	if (!count || period == 0.0 || period == INFINITY) {
+		self->skew = NAN;
+		return;
+	}
+	self->skew = atan2(sum_sin, sum_cos) / (2.0 * M_PI) * period;
+}
+
+/*
+ * Both lines are requested together, so they must belong to the same chip.
+ */
+EXPORT int gpiod_frequency_phase_count(
+	gpiod_frequency_phase *self,
+	int waves,
+	const struct timespec *timeout
+) {
+	int rc = 0;
+	struct gpiod_line_bulk bulk;
+	gpiod_line_bulk_init(&bulk);
+	for (int i = 0; i < 2; ++i) {
+		gpiod_line_bulk_add(&bulk, self->counter[i].line);
+	}
+	rc = gpiod_line_request_bulk_both_edges_events_flags(
+		&bulk,
+		self->counter[0].name,
+		self->counter[0].flags
+	);
+	if (rc) {
+		dbg("gpiod_line_request_bulk_both_edges_events: %s\n", strerror(errno));
+		return -1;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	dbg_timespec("start", start);
+
+	if (waves == 0) {
+		waves = self->counter[0].period_buf_size;
+	}
+
+	struct pollfd fds[3];
+	int nfds = 2;
+	int pending[2];
+	for (int i = 0; i < 2; ++i) {
+		fds[i].fd = gpiod_line_event_get_fd(self->counter[i].line);
+		fds[i].events = POLLIN | POLLPRI;
+		fds[i].revents = 0;
+		pending[i] = waves * 2 + 1;
+		self->counter[i].last_event.event_type = 0;
+		if (fds[i].fd < 0) {
+			rc = -1;
+			goto end;
+		}
+	}
+	self->has_rising = 0;
+	if (timeout) {
+		fds[2].fd = deadline_timer_create(&start, timeout);
+		fds[2].events = POLLIN;
+		fds[2].revents = 0;
+		if (fds[2].fd < 0) {
+			rc = -1;
+			goto end;
+		}
+		++nfds;
+	}
+
+	/*
+	 * Events are queued per line and merged by timestamp across reads.
+	 * When one queue is empty, an event of the other line is processed
+	 * only if it is older than the last time the empty line was seen
+	 * drained, so that no earlier edge of it can still be unread.
+	 */
+	struct gpiod_line_event queue[2][2 * EVENT_BATCH_SIZE];
+	int queue_start[2] = { 0, 0 };
+	int queue_end[2] = { 0, 0 };
+	int64_t drained[2] = { 0, 0 };
+
+	while (pending[0] > 0 || pending[1] > 0) {
+		/* taken before poll(), as any edge up to it is queued by then */
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		rc = poll(fds, nfds, -1);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			dbg("poll: %s\n", strerror(errno));
+			rc = -1;
+			break;
+		}
+		int ready = 0;
+		for (int i = 0; i < 2; ++i) {
+			if (!fds[i].revents) {
+				drained[i] = timespec_to_ns(now);
+				continue;
+			}
+			ready = 1;
+			int len = queue_end[i] - queue_start[i];
+			memmove(
+				queue[i],
+				queue[i] + queue_start[i],
+				len * sizeof(**queue)
+			);
+			queue_start[i] = 0;
+			queue_end[i] = len;
+			int space = 2 * EVENT_BATCH_SIZE - len;
+			if (space > EVENT_BATCH_SIZE) {
+				space = EVENT_BATCH_SIZE;
+			}
+			if (!space) {
+				continue;
+			}
+			int count = gpiod_line_event_read_fd_multiple(
+				fds[i].fd,
+				queue[i] + len,
+				space
+			);
+			if (count < 0) {
+				dbg("gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+				rc = -1;
+				goto end;
+			}
+			queue_end[i] += count;
+			if (count < space) {
+				drained[i] = timespec_to_ns(now);
+			}
+		}
+		if (!ready) {
+			if (nfds > 2 && fds[2].revents) {
+				dbg("deadline expired\n");
+				break;
+			}
+		}
+		while (1) {
+			int i;
+			int has[2] = {
+				queue_start[0] < queue_end[0],
+				queue_start[1] < queue_end[1]
+			};
+			if (has[0] && has[1]) {
+				i = timespec_gt(
+					&queue[0][queue_start[0]].ts,
+					&queue[1][queue_start[1]].ts
+				);
+			} else if (has[0] || has[1]) {
+				i = has[1];
+				if (timespec_to_ns(queue[i][queue_start[i]].ts) > drained[!i]) {
+					break;
+				}
+			} else {
+				break;
+			}
+			struct gpiod_line_event *ev = &queue[i][queue_start[i]++];
+			if (!timespec_gt(&ev->ts, &start)) {
+				continue;
+			}
+			dbg_event("event", *ev);
+			gpiod_frequency_phase_add_event(self, i, ev);
+			--pending[i];
+		}
+	}
+	rc = rc < 0 ? -1 : 0;
+
+end:
+	if (nfds > 2) {
+		close(fds[2].fd);
+	}
+	gpiod_frequency_phase_update(self);
+	gpiod_line_release_bulk(&bulk);
+	return rc;
+}
+
+EXPORT gpiod_frequency_counter *gpiod_frequency_phase_get_counter(
+	gpiod_frequency_phase *self,
+	int index
+) {
+	return &self->counter[index];
+}
+
+EXPORT double gpiod_frequency_phase_get_skew(gpiod_frequency_phase *self) {
+	return self->skew;
+}
+
+EXPORT double gpiod_frequency_phase_get_phase(gpiod_frequency_phase *self) {
+	double period = gpiod_frequency_counter_get_period(&self->counter[0]);
+	if (period == 0.0 || period == INFINITY || isnan(self->skew)) {
+		return NAN;
+	}
+	return 360.0 * self->skew / period;
+}
+
+EXPORT double gpiod_frequency_phase_get_frequency_ratio(
+	gpiod_frequency_phase *self
+) {
+	double reference = gpiod_frequency_counter_get_frequency(&self->counter[0]);
+	double frequency = gpiod_frequency_counter_get_frequency(&self->counter[1]);
+	if (reference == 0.0) {
+		return NAN;
+	}
+	return frequency / reference;
+}
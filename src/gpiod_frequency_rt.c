@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include <util.h>
+#include <gpiod_frequency_rt.h>
+
+#include <alloca.h>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* the stack is pre-faulted with alloca(), so it is kept well below its limit */
+#define PREFAULT_STACK_MAX (1024 * 1024)
+
+EXPORT void gpiod_frequency_rt_init(gpiod_frequency_rt *self) {
+	self->policy = -1;
+	self->priority = 0;
+	self->cpu = -1;
+	self->lock_memory = 0;
+	self->prefault_stack = 0;
+}
+
+__attribute__((noinline))
+static void prefault_stack(size_t size) {
+	char *buf = alloca(size);
+	memset(buf, 0, size);
+	__asm__ __volatile__("" : : "r"(buf) : "memory");
+}
+
+/*
+ * Applies the options to the calling thread. The scheduling policy and
+ * affinity stay in effect until changed again, see rt_save(). Memory
+ * locking is process wide, is done once and is never undone.
+ */
+EXPORT int gpiod_frequency_rt_apply(const gpiod_frequency_rt *self) {
+	static int memory_locked = 0;
+	int rc;
+	if (self->cpu >= CPU_SETSIZE
+	    || self->cpu >= sysconf(_SC_NPROCESSORS_CONF)
+	    || self->prefault_stack > PREFAULT_STACK_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (self->lock_memory
+	    && !__atomic_load_n(&memory_locked, __ATOMIC_RELAXED)) {
+		if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+			dbg("mlockall: %s\n", strerror(errno));
+			return -1;
+		}
+		__atomic_store_n(&memory_locked, 1, __ATOMIC_RELAXED);
+	}
+	if (self->prefault_stack) {
+		prefault_stack(self->prefault_stack);
+	}
+	if (self->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(self->cpu, &set);
+		rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (rc) {
+			errno = rc;
+			dbg("pthread_setaffinity_np: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+	if (self->policy >= 0) {
+		struct sched_param param = { .sched_priority = self->priority };
+		rc = pthread_setschedparam(pthread_self(), self->policy, &param);
+		if (rc) {
+			errno = rc;
+			dbg("pthread_setschedparam: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+EXPORT void gpiod_frequency_latency_reset(gpiod_frequency_latency *self) {
+	memset(self, 0, sizeof(*self));
+}
+
+EXPORT double gpiod_frequency_latency_get_mean(
+	const gpiod_frequency_latency *self
+) {
+	if (!self->wakeups) {
+		return 0.0;
+	}
+	return 1e-9 * self->sum_ns / self->wakeups;
+}
+
+EXPORT double gpiod_frequency_latency_get_max(
+	const gpiod_frequency_latency *self
+) {
+	return 1e-9 * self->max_ns;
+}
+
+_Static_assert(
+	sizeof(((rt_state*)0)->affinity) == sizeof(cpu_set_t),
+	"rt_state affinity size"
+);
+
+/*
+ * Saves the scheduling policy, priority and affinity of the calling
+ * thread so that rt_restore() can undo gpiod_frequency_rt_apply().
+ */
+int rt_save(rt_state *state) {
+	struct sched_param param;
+	int rc = pthread_getschedparam(pthread_self(), &state->policy, &param);
+	if (rc) {
+		errno = rc;
+		dbg("pthread_getschedparam: %s\n", strerror(errno));
+		return -1;
+	}
+	state->priority = param.sched_priority;
+	rc = pthread_getaffinity_np(
+		pthread_self(),
+		sizeof(cpu_set_t),
+		(cpu_set_t*)state->affinity
+	);
+	if (rc) {
+		errno = rc;
+		dbg("pthread_getaffinity_np: %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+void rt_restore(const rt_state *state) {
+	struct sched_param param = { .sched_priority = state->priority };
+	int rc = pthread_setschedparam(pthread_self(), state->policy, &param);
+	if (rc) {
+		dbg("pthread_setschedparam: %s\n", strerror(rc));
+	}
+	rc = pthread_setaffinity_np(
+		pthread_self(),
+		sizeof(cpu_set_t),
+		(const cpu_set_t*)state->affinity
+	);
+	if (rc) {
+		dbg("pthread_setaffinity_np: %s\n", strerror(rc));
+	}
+}
@@ -0,0 +1,282 @@
+#include <util.h>
+#include <gpiod_frequency_totalizer.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+EXPORT int gpiod_frequency_totalizer_init(
+	gpiod_frequency_totalizer *self,
+	struct gpiod_line *line,
+	int edges,
+	const char *name,
+	int flags
+) {
+	memset(self, 0, sizeof(*self));
+	self->stop_fd = -1;
+	if (edges < GPIOD_FREQUENCY_TOTALIZER_RISING_EDGE
+	    || edges > GPIOD_FREQUENCY_TOTALIZER_BOTH_EDGES) {
+		errno = EINVAL;
+		return -1;
+	}
+	self->line = line;
+	self->edges = edges;
+	self->flags = flags;
+	self->name = strdup(name ? name : "gpiod_frequency_totalizer");
+	if (!self->name) {
+		return -1;
+	}
+	return 0;
+}
+
+EXPORT void gpiod_frequency_totalizer_destroy(gpiod_frequency_totalizer *self) {
+	if (self->running) {
+		gpiod_frequency_totalizer_stop(self);
+	}
+	if (self->name) {
+		free(self->name);
+		self->name = NULL;
+	}
+	self->line = NULL;
+}
+
+/*
+ * Edge selection is done by the kernel, so every event read is counted:
+ * the per-batch work is one add and one timestamp store.
+ */
+static void *capture(void *data) {
+	gpiod_frequency_totalizer *self = data;
+	struct gpiod_line_event events[EVENT_BATCH_SIZE];
+	struct pollfd fds[2] = {
+		{
+			.fd = gpiod_line_event_get_fd(self->line),
+			.events = POLLIN | POLLPRI
+		},
+		{ .fd = self->stop_fd, .events = POLLIN },
+	};
+	uint64_t count = self->count;
+	uint32_t seq = self->seq;
+	int drained = 1;
+	gpiod_frequency_latency latency = self->latency;
+
+	if (self->rt && gpiod_frequency_rt_apply(self->rt)) {
+		__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	while (1) {
+		int rc = poll(fds, 2, -1);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			dbg("poll: %s\n", strerror(errno));
+			__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			break;
+		}
+		if (fds[1].revents) {
+			break;
+		}
+		struct timespec wakeup;
+		if (self->rt) {
+			clock_gettime(CLOCK_MONOTONIC, &wakeup);
+		}
+		rc = gpiod_line_event_read_fd_multiple(
+			fds[0].fd,
+			events,
+			EVENT_BATCH_SIZE
+		);
+		if (rc < 0) {
+			dbg("gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+			__atomic_store_n(&self->error, errno, __ATOMIC_RELAXED);
+			break;
+		}
+		count += rc;
+		int woken = self->rt && drained;
+		if (woken) {
+			latency_add(&latency, &wakeup, &events[0]);
+		}
+		/* count, last_ts and latency are published together under seq */
+		__atomic_store_n(&self->seq, seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		__atomic_store_n(
+			&self->last_ts,
+			timespec_to_ns(events[rc - 1].ts),
+			__ATOMIC_RELAXED
+		);
+		__atomic_store_n(&self->count, count, __ATOMIC_RELAXED);
+		if (woken) {
+			__atomic_store_n(
+				&self->latency.max_ns,
+				latency.max_ns,
+				__ATOMIC_RELAXED
+			);
+			__atomic_store_n(
+				&self->latency.sum_ns,
+				latency.sum_ns,
+				__ATOMIC_RELAXED
+			);
+			__atomic_store_n(
+				&self->latency.wakeups,
+				latency.wakeups,
+				__ATOMIC_RELAXED
+			);
+		}
+		seq += 2;
+		__atomic_store_n(&self->seq, seq, __ATOMIC_RELEASE);
+		drained = rc < EVENT_BATCH_SIZE;
+	}
+	return NULL;
+}
+
+/*
+ * Real-time options are applied to the capture thread when it starts.
+ * Wake-up latency is recorded while they are set.
+ */
+EXPORT void gpiod_frequency_totalizer_set_rt(
+	gpiod_frequency_totalizer *self,
+	const gpiod_frequency_rt *rt
+) {
+	self->rt = rt;
+}
+
+EXPORT int gpiod_frequency_totalizer_start(gpiod_frequency_totalizer *self) {
+	int rc;
+	if (self->running) {
+		errno = EBUSY;
+		return -1;
+	}
+	switch (self->edges) {
+		case GPIOD_FREQUENCY_TOTALIZER_RISING_EDGE:
+			rc = gpiod_line_request_rising_edge_events_flags(
+				self->line,
+				self->name,
+				self->flags
+			);
+			break;
+		case GPIOD_FREQUENCY_TOTALIZER_FALLING_EDGE:
+			rc = gpiod_line_request_falling_edge_events_flags(
+				self->line,
+				self->name,
+				self->flags
+			);
+			break;
+		default:
+			rc = gpiod_line_request_both_edges_events_flags(
+				self->line,
+				self->name,
+				self->flags
+			);
+	}
+	if (rc) {
+		dbg("gpiod_line_request_events: %s\n", strerror(errno));
+		return -1;
+	}
+	if (gpiod_line_event_get_fd(self->line) < 0) {
+		dbg("gpiod_line_event_get_fd: %s\n", strerror(errno));
+		goto error;
+	}
+	self->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (self->stop_fd < 0) {
+		dbg("eventfd: %s\n", strerror(errno));
+		goto error;
+	}
+	self->error = 0;
+	rc = pthread_create(&self->thread, NULL, capture, self);
+	if (rc) {
+		errno = rc;
+		dbg("pthread_create: %s\n", strerror(errno));
+		goto error;
+	}
+	self->running = 1;
+	return 0;
+error:
+	if (self->stop_fd >= 0) {
+		close(self->stop_fd);
+		self->stop_fd = -1;
+	}
+	gpiod_line_release(self->line);
+	return -1;
+}
+
+EXPORT int gpiod_frequency_totalizer_stop(gpiod_frequency_totalizer *self) {
+	if (!self->running) {
+		errno = EINVAL;
+		return -1;
+	}
+	uint64_t one = 1;
+	if (write(self->stop_fd, &one, sizeof(one)) < 0) {
+		dbg("write: %s\n", strerror(errno));
+		return -1;
+	}
+	pthread_join(self->thread, NULL);
+	close(self->stop_fd);
+	self->stop_fd = -1;
+	gpiod_line_release(self->line);
+	self->running = 0;
+	return 0;
+}
+
+EXPORT uint64_t gpiod_frequency_totalizer_get_count(
+	gpiod_frequency_totalizer *self
+) {
+	return __atomic_load_n(&self->count, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Edge rate since the previous call, measured between edge timestamps.
+ * Returns 0 if no edges were counted since then.
+ */
+EXPORT double gpiod_frequency_totalizer_get_rate(
+	gpiod_frequency_totalizer *self
+) {
+	uint64_t count;
+	int64_t ts;
+	uint32_t seq;
+	do {
+		while ((seq = __atomic_load_n(&self->seq, __ATOMIC_ACQUIRE)) & 1) {
+			/* the capture thread holds it for a few stores */
+		}
+		count = __atomic_load_n(&self->count, __ATOMIC_RELAXED);
+		ts = __atomic_load_n(&self->last_ts, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&self->seq, __ATOMIC_RELAXED) != seq);
+	uint64_t edges = count - self->rate_count;
+	int64_t elapsed = ts - self->rate_ts;
+	double rate = 0.0;
+	if (edges && self->rate_ts && elapsed > 0) {
+		rate = 1e9 * edges / elapsed;
+	}
+	self->rate_count = count;
+	self->rate_ts = ts;
+	return rate;
+}
+
+EXPORT int gpiod_frequency_totalizer_get_error(
+	gpiod_frequency_totalizer *self
+) {
+	return __atomic_load_n(&self->error, __ATOMIC_RELAXED);
+}
+
+EXPORT void gpiod_frequency_totalizer_get_latency(
+	gpiod_frequency_totalizer *self,
+	gpiod_frequency_latency *latency
+) {
+	uint32_t seq;
+	do {
+		while ((seq = __atomic_load_n(&self->seq, __ATOMIC_ACQUIRE)) & 1) {
+			/* the capture thread holds it for a few stores */
+		}
+		latency->wakeups = __atomic_load_n(
+			&self->latency.wakeups,
+			__ATOMIC_RELAXED
+		);
+		latency->sum_ns = __atomic_load_n(&self->latency.sum_ns, __ATOMIC_RELAXED);
+		latency->max_ns = __atomic_load_n(&self->latency.max_ns, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&self->seq, __ATOMIC_RELAXED) != seq);
+}
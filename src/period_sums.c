@@ -0,0 +1,201 @@
+#include <util.h>
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#endif
+
+/*
+ * Masked aggregation over period buffers: only elements greater than
+ * zero are taken into account, as empty slots are stored as zeros.
+ * The kernels are picked once at runtime by the available CPU features.
+ */
+
+static void period_sums_scalar(
+	const double *buf,
+	size_t size,
+	period_sums *res
+) {
+	for (size_t i = 0; i < size; ++i) {
+		double x = buf[i];
+		if (x > 0.0) {
+			++res->count;
+			res->sum += x;
+			res->sum_sq += x * x;
+			if (x < res->min) {
+				res->min = x;
+			}
+			if (x > res->max) {
+				res->max = x;
+			}
+		}
+	}
+}
+
+static void period_sums_reduce(
+	const double *count,
+	const double *sum,
+	const double *sum_sq,
+	const double *min,
+	const double *max,
+	int lanes,
+	period_sums *res
+) {
+	for (int i = 0; i < lanes; ++i) {
+		res->count += count[i];
+		res->sum += sum[i];
+		res->sum_sq += sum_sq[i];
+		if (min[i] < res->min) {
+			res->min = min[i];
+		}
+		if (max[i] > res->max) {
+			res->max = max[i];
+		}
+	}
+}
+
+#ifdef HAVE_X86
+__attribute__((target("sse2")))
+static void period_sums_sse2(
+	const double *buf,
+	size_t size,
+	period_sums *res
+) {
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d inf = _mm_set1_pd(INFINITY);
+	__m128d count = zero, sum = zero, sum_sq = zero;
+	__m128d min = inf, max = zero;
+	size_t i = 0;
+	for (; i + 2 <= size; i += 2) {
+		__m128d x = _mm_loadu_pd(buf + i);
+		__m128d mask = _mm_cmpgt_pd(x, zero);
+		__m128d valid = _mm_and_pd(x, mask);
+		count = _mm_add_pd(count, _mm_and_pd(one, mask));
+		sum = _mm_add_pd(sum, valid);
+		sum_sq = _mm_add_pd(sum_sq, _mm_mul_pd(valid, valid));
+		min = _mm_min_pd(min, _mm_or_pd(valid, _mm_andnot_pd(mask, inf)));
+		max = _mm_max_pd(max, valid);
+	}
+	double c[2], s[2], sq[2], mn[2], mx[2];
+	_mm_storeu_pd(c, count);
+	_mm_storeu_pd(s, sum);
+	_mm_storeu_pd(sq, sum_sq);
+	_mm_storeu_pd(mn, min);
+	_mm_storeu_pd(mx, max);
+	period_sums_reduce(c, s, sq, mn, mx, 2, res);
+	period_sums_scalar(buf + i, size - i, res);
+}
+
+__attribute__((target("avx2")))
+static void period_sums_avx2(
+	const double *buf,
+	size_t size,
+	period_sums *res
+) {
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d inf = _mm256_set1_pd(INFINITY);
+	__m256d count = zero, sum = zero, sum_sq = zero;
+	__m256d min = inf, max = zero;
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4) {
+		__m256d x = _mm256_loadu_pd(buf + i);
+		__m256d mask = _mm256_cmp_pd(x, zero, _CMP_GT_OQ);
+		__m256d valid = _mm256_and_pd(x, mask);
+		count = _mm256_add_pd(count, _mm256_and_pd(one, mask));
+		sum = _mm256_add_pd(sum, valid);
+		sum_sq = _mm256_add_pd(sum_sq, _mm256_mul_pd(valid, valid));
+		min = _mm256_min_pd(min, _mm256_blendv_pd(inf, x, mask));
+		max = _mm256_max_pd(max, valid);
+	}
+	double c[4], s[4], sq[4], mn[4], mx[4];
+	_mm256_storeu_pd(c, count);
+	_mm256_storeu_pd(s, sum);
+	_mm256_storeu_pd(sq, sum_sq);
+	_mm256_storeu_pd(mn, min);
+	_mm256_storeu_pd(mx, max);
+	period_sums_reduce(c, s, sq, mn, mx, 4, res);
+	period_sums_scalar(buf + i, size - i, res);
+}
+#endif
+
+#if defined(HAVE_NEON) && defined(__aarch64__)
+static void period_sums_neon(
+	const double *buf,
+	size_t size,
+	period_sums *res
+) {
+	const float64x2_t zero = vdupq_n_f64(0.0);
+	const float64x2_t inf = vdupq_n_f64(INFINITY);
+	uint64x2_t count = vdupq_n_u64(0);
+	float64x2_t sum = zero, sum_sq = zero;
+	float64x2_t min = inf, max = zero;
+	size_t i = 0;
+	for (; i + 2 <= size; i += 2) {
+		float64x2_t x = vld1q_f64(buf + i);
+		uint64x2_t mask = vcgtq_f64(x, zero);
+		float64x2_t valid = vreinterpretq_f64_u64(
+			vandq_u64(vreinterpretq_u64_f64(x), mask)
+		);
+		count = vsubq_u64(count, mask);
+		sum = vaddq_f64(sum, valid);
+		sum_sq = vfmaq_f64(sum_sq, valid, valid);
+		min = vminq_f64(min, vbslq_f64(mask, x, inf));
+		max = vmaxq_f64(max, valid);
+	}
+	double c[2], s[2], sq[2], mn[2], mx[2];
+	c[0] = vgetq_lane_u64(count, 0);
+	c[1] = vgetq_lane_u64(count, 1);
+	vst1q_f64(s, sum);
+	vst1q_f64(sq, sum_sq);
+	vst1q_f64(mn, min);
+	vst1q_f64(mx, max);
+	period_sums_reduce(c, s, sq, mn, mx, 2, res);
+	period_sums_scalar(buf + i, size - i, res);
+}
+#endif
+
+typedef void (*period_sums_fn)(const double *, size_t, period_sums *);
+
+static period_sums_fn select_period_sums() {
+#ifdef HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		dbg("period_sums: avx2\n");
+		return period_sums_avx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		dbg("period_sums: sse2\n");
+		return period_sums_sse2;
+	}
+#endif
+#if defined(HAVE_NEON) && defined(__aarch64__)
+	dbg("period_sums: neon\n");
+	return period_sums_neon;
+#endif
+	dbg("period_sums: scalar\n");
+	return period_sums_scalar;
+}
+
+void get_period_sums(const double *buf, size_t size, period_sums *res) {
+	static period_sums_fn fn = NULL;
+	period_sums_fn f = __atomic_load_n(&fn, __ATOMIC_RELAXED);
+	if (!f) {
+		f = select_period_sums();
+		__atomic_store_n(&fn, f, __ATOMIC_RELAXED);
+	}
+	res->count = 0;
+	res->sum = 0.0;
+	res->sum_sq = 0.0;
+	res->min = INFINITY;
+	res->max = 0.0;
+	f(buf, size, res);
+}
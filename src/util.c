@@ -3,6 +3,9 @@
 #include <math.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 /*double timespec_to_double(const struct timespec *tv) {
 	return (double)tv->tv_sec + 1e-9 * tv->tv_nsec;
@@ -47,60 +50,197 @@ int timespec_ge(
 	        || (x->tv_sec == y->tv_sec && x->tv_nsec >= y->tv_nsec));
 }
 
-int update_timeout(
+void timespec_add(
+	const struct timespec *x,
+	const struct timespec *y,
+	struct timespec *res
+) {
+	res->tv_sec = x->tv_sec + y->tv_sec;
+	res->tv_nsec = x->tv_nsec + y->tv_nsec;
+	if (res->tv_nsec >= 1000000000) {
+		++res->tv_sec;
+		res->tv_nsec -= 1000000000;
+	}
+}
+
+/*
+ * The deadline is armed once as an absolute CLOCK_MONOTONIC timer and
+ * polled together with the line, so no time arithmetic is done per edge.
+ */
+int deadline_timer_create(
 	const struct timespec *start,
-	const struct timespec *timeout,
-	struct timespec *remaining
+	const struct timespec *timeout
 ) {
-	if (!timeout) {
-		return 0;
-	}
-	struct timespec time, elapsed;
-	clock_gettime(CLOCK_MONOTONIC, &time);
-	timespec_diff(start, &time, &elapsed);
-	dbg_timespec("elapsed", elapsed);
-	if(timespec_ge(&elapsed, timeout)) {
-		remaining->tv_sec = 0;
-		remaining->tv_nsec = 0;
-		return 1;
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (fd < 0) {
+		dbg("timerfd_create: %s\n", strerror(errno));
+		return -1;
 	}
-	timespec_diff(&elapsed, timeout, remaining);
-	return 0;
+	struct itimerspec deadline = {0};
+	timespec_add(start, timeout, &deadline.it_value);
+	dbg_timespec("deadline", deadline.it_value);
+	if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &deadline, NULL)) {
+		dbg("timerfd_settime: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
 }
 
-int read_event(
+int event_reader_init(
+	event_reader *self,
 	struct gpiod_line *line,
-	struct gpiod_line_event *ev,
+	const struct timespec *start,
 	const struct timespec *timeout
 ) {
-	int rc = gpiod_line_event_wait(line, timeout);
-	if (rc < 0) {
-		dbg("gpiod_line_event_wait: %s\n", strerror(errno));
+	self->line = line;
+	self->fd = gpiod_line_event_get_fd(line);
+	self->timer_fd = -1;
+	self->count = 0;
+	self->offset = 0;
+	self->latency = NULL;
+	if (self->fd < 0) {
+		dbg("gpiod_line_event_get_fd: %s\n", strerror(errno));
 		return -1;
 	}
-	if (rc > 0) {
-		int rc_ = gpiod_line_event_read(line, ev);
-		if (rc_ < 0) {
-			dbg("gpiod_line_event_read: %s\n", strerror(errno));
+	if (timeout) {
+		self->timer_fd = deadline_timer_create(start, timeout);
+		if (self->timer_fd < 0) {
+			return -1;
 		}
 	}
+	return 0;
+}
+
+void event_reader_destroy(event_reader *self) {
+	if (self->timer_fd >= 0) {
+		close(self->timer_fd);
+		self->timer_fd = -1;
+	}
+}
+
+static int event_reader_fill(event_reader *self) {
+	int rc = gpiod_line_event_read_fd_multiple(
+		self->fd,
+		self->events,
+		EVENT_BATCH_SIZE
+	);
+	if (rc < 0) {
+		dbg("gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+		self->count = 0;
+		self->offset = 0;
+		return -1;
+	}
+	self->count = rc;
+	self->offset = 0;
 	return rc;
 }
 
-double get_period(double *buf, int size) {
-	double sum = 0.0;
-	int count = 0;
+/*
+ * Drain the events queued before start in batches without waiting.
+ * Queued events newer than start are kept for read_event().
+ */
+int event_reader_skip(event_reader *self, const struct timespec *start) {
+	while (1) {
+		while (self->offset < self->count) {
+			if (timespec_gt(&self->events[self->offset].ts, start)) {
+				return 0;
+			}
+			++self->offset;
+		}
+		struct pollfd pfd = { .fd = self->fd, .events = POLLIN | POLLPRI };
+		int rc = poll(&pfd, 1, 0);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			dbg("poll: %s\n", strerror(errno));
+			return -1;
+		}
+		if (rc == 0) {
+			return 0;
+		}
+		if (event_reader_fill(self) < 0) {
+			return -1;
+		}
+		dbg("skip: %d events\n", self->count);
+	}
+}
+
+int read_event(event_reader *self, struct gpiod_line_event *ev) {
+	if (self->offset < self->count) {
+		*ev = self->events[self->offset++];
+		return 1;
+	}
+	int drained = self->count < EVENT_BATCH_SIZE;
+	struct timespec wakeup;
+	if (self->timer_fd >= 0) {
+		struct pollfd fds[2] = {
+			{ .fd = self->fd, .events = POLLIN | POLLPRI },
+			{ .fd = self->timer_fd, .events = POLLIN },
+		};
+		int rc;
+		do {
+			rc = poll(fds, 2, -1);
+		} while (rc < 0 && errno == EINTR);
+		if (rc < 0) {
+			dbg("poll: %s\n", strerror(errno));
+			return -1;
+		}
+		if (!fds[0].revents) {
+			dbg("deadline expired\n");
+			return 0;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &wakeup);
+	}
+	if (event_reader_fill(self) <= 0) {
+		return -1;
+	}
+	if (self->latency && drained) {
+		if (self->timer_fd < 0) {
+			/* the read blocked until the wake-up */
+			clock_gettime(CLOCK_MONOTONIC, &wakeup);
+		}
+		latency_add(self->latency, &wakeup, &self->events[0]);
+	}
+	*ev = self->events[self->offset++];
+	return 1;
+}
+
+/*
+ * Wake-up latency is the time from the kernel timestamp of the oldest
+ * event in a batch to the wake-up that found it. It is recorded once per
+ * batch, and only for batches read after the queue had been drained:
+ * otherwise the oldest event waited for processing, not for a wake-up.
+ */
+void latency_add(
+	gpiod_frequency_latency *latency,
+	const struct timespec *wakeup,
+	const struct gpiod_line_event *ev
+) {
+	int64_t ns = timespec_to_ns(*wakeup) - timespec_to_ns(ev->ts);
+	if (ns < 0) {
+		ns = 0;
+	}
+	++latency->wakeups;
+	latency->sum_ns += ns;
+	if ((uint64_t)ns > latency->max_ns) {
+		latency->max_ns = ns;
+	}
+}
+
+double get_period(const double *buf, size_t size) {
+	period_sums sums;
+#if DEBUG != 0
 	dbg("[ ");
-	for (int i = 0; i < size; ++i) {
+	for (size_t i = 0; i < size; ++i) {
 		dbg("%.04lf, ", buf[i]);
-		if (buf[i] > 0.0) {
-			++count;
-			sum += buf[i];
-		}
 	}
 	dbg("]\n");
-	if (count == 0) {
+#endif
+	get_period_sums(buf, size, &sums);
+	if (sums.count == 0) {
 		return INFINITY;
 	}
-	return sum / count;
+	return sums.sum / sums.count;
 }
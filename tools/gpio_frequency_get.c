@@ -1,5 +1,6 @@
 #include <util.h>
 #include <gpiod_frequency_counter.h>
+#include "rt_args.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -23,6 +24,9 @@ typedef struct arguments {
 	unsigned long line;
 	int buf_size;
 	int print;
+	int latency;
+	int rt;
+	gpiod_frequency_rt _rt;
 	struct timespec *interval;
 	struct timespec _interval;
 } arguments;
@@ -33,6 +37,9 @@ void init_args(struct arguments *args) {
 	args->line = 0;
 	args->buf_size = 32;
 	args->print = PRINT_FREQUENCY;
+	args->latency = 0;
+	args->rt = 0;
+	gpiod_frequency_rt_init(&args->_rt);
 	args->interval = NULL;
 	args->_interval.tv_sec = 0;
 	args->_interval.tv_nsec = 0;
@@ -43,13 +50,15 @@ void print_help(const char *name) {
 	init_args(&args);
 	fprintf(
 		stderr,
-		"Usage: %s [-h] [-i <time>] [-b <size>] [-f <format>] [-p | -P | -d | -F | -a] <chip name/number> <offset>\n"
+		"Usage: %s [-h] [-i <time>] [-b <size>] [-f <format>] " RT_ARGS_USAGE " [-l] [-p | -P | -d | -F | -a] <chip name/number> <offset>\n"
 		"\n"
 		"Options:\n"
 		"    -h, --help               print this help text and exit\n"
 		"    -i, --interval <time>    maximum time in seconds (default: none)\n"
 		"    -b, --buf-size <size>    period buffer size (default: %d)\n"
 		"    -f, --format <format>    output format string (defult: %s)\n"
+		RT_ARGS_HELP
+		"    -l, --latency            print wake-up latency (mean max)\n"
 		"    -p, --period             print period\n"
 		"    -P, --split-period       print low and high periods\n"
 		"    -d, --duty-cycle         print duty cycle\n"
@@ -115,6 +124,10 @@ int parse_args(int argc, char **argv, struct arguments *args) {
 				goto missing_arg;
 			}
 			args->format = argv[i++];
+		} else if (!strcmp(arg, "-l") || !strcmp(arg, "--latency")) {
+			++i;
+			args->latency = 1;
+			args->rt = 1;
 		} else if (!strcmp(arg, "-p") || !strcmp(arg, "--period")) {
 			++i;
 			args->print = PRINT_PERIOD;
@@ -131,7 +144,14 @@ int parse_args(int argc, char **argv, struct arguments *args) {
 			++i;
 			args->print = PRINT_ALL;
 		} else {
-			break;
+			int rc = parse_rt_arg(argc, argv, &i, &args->_rt);
+			if (rc < 0) {
+				return 1;
+			}
+			if (rc) {
+				break;
+			}
+			args->rt = 1;
 		}
 	}
 	if (argc - i != 2) {
@@ -180,6 +200,9 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "gpiod_frequency_counter_init: %s\n", strerror(errno));
 		goto error;
 	}
+	if (args.rt) {
+		gpiod_frequency_counter_set_rt(&counter, &args._rt);
+	}
 	if (gpiod_frequency_counter_count(&counter, 0, args.interval)) {
 		fprintf(stderr, "gpiod_frequency_counter_count: %s\n", strerror(errno));
 		goto error;
@@ -245,6 +268,16 @@ int main(int argc, char **argv) {
 
 	putchar('\n');
 
+	if (args.latency) {
+		const gpiod_frequency_latency *latency =
+			gpiod_frequency_counter_get_latency(&counter);
+		printf(
+			"%.09lf %.09lf\n",
+			gpiod_frequency_latency_get_mean(latency),
+			gpiod_frequency_latency_get_max(latency)
+		);
+	}
+
 	gpiod_frequency_counter_destroy(&counter);
 	gpiod_chip_close(chip);
 	return 0;
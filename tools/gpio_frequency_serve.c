@@ -0,0 +1,682 @@
+#include <util.h>
+#include <gpiod_frequency_counter_pool.h>
+#include "rt_args.h"
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gpiod.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+/*
+ * Keeps all lines requested and counting, rebuilds a text snapshot of
+ * the results every interval and writes it to every client connecting
+ * to the socket.
+ */
+
+enum {
+	FD_SIGNAL,
+	FD_TIMER,
+	FD_SOCKET,
+	FD_LINES
+};
+
+/* clients being written to at once, further ones wait in the backlog */
+#define MAX_CLIENTS 16
+/* clients not done reading after this many seconds are dropped */
+#define CLIENT_TIMEOUT 5.0
+
+typedef struct arguments {
+	const char *socket;
+	const char *name;
+	int buf_size;
+	int rt;
+	gpiod_frequency_rt _rt;
+	double interval;
+	double timeout;
+	char **lines;
+	size_t size;
+} arguments;
+
+typedef struct line_stats {
+	uint64_t edges;
+	uint64_t reads;
+	int64_t last_edge;
+	int stale;
+} line_stats;
+
+/* A client gets a copy of the snapshot, sent as the socket drains */
+typedef struct client {
+	char *buf;
+	size_t len;
+	size_t offset;
+	int64_t start;
+} client;
+
+typedef struct server {
+	gpiod_frequency_counter_pool pool;
+	struct gpiod_chip **chips;
+	size_t chip_count;
+	line_stats *stats;
+	struct pollfd *fds;
+	size_t nfds;
+	struct pollfd *client_fds;
+	client clients[MAX_CLIENTS];
+	int64_t start;
+	uint64_t wakeups;
+	uint64_t scrapes;
+	uint64_t snapshots;
+	double build_time;
+	char *snapshot;
+	size_t snapshot_len;
+	size_t snapshot_size;
+} server;
+
+static int64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return timespec_to_ns(ts);
+}
+
+void init_args(struct arguments *args) {
+	args->socket = "/run/gpio-frequency.sock";
+	args->name = "gpio-frequency-serve";
+	args->buf_size = 32;
+	args->rt = 0;
+	gpiod_frequency_rt_init(&args->_rt);
+	args->interval = 1.0;
+	args->timeout = 5.0;
+	args->lines = NULL;
+	args->size = 0;
+}
+
+void print_help(const char *name) {
+	struct arguments args;
+	init_args(&args);
+	fprintf(
+		stderr,
+		"Usage: %s [-h] [-s <path>] [-i <time>] [-t <time>] [-b <size>] " RT_ARGS_USAGE " <chip name/number> <offset> [<chip name/number> <offset>...]\n"
+		"\n"
+		"Options:\n"
+		"    -h, --help               print this help text and exit\n"
+		"    -s, --socket <path>      unix socket path (default: %s)\n"
+		"    -i, --interval <time>    snapshot interval in seconds (default: %g)\n"
+		"    -t, --timeout <time>     report 0Hz after no edges for this many seconds (default: %g)\n"
+		"    -b, --buf-size <size>    period buffer size (default: %d)\n"
+		RT_ARGS_HELP,
+		name,
+		args.socket,
+		args.interval,
+		args.timeout,
+		args.buf_size
+	);
+}
+
+static int parse_time(const char *arg, double *res) {
+	double time = strtod(arg, NULL);
+	if (time <= 0.0) {
+		fprintf(stderr, "Time must be greater than 0 (got %s)\n", arg);
+		return 1;
+	}
+	*res = time;
+	return 0;
+}
+
+int parse_args(int argc, char **argv, struct arguments *args) {
+	int i = 1;
+	const char *arg;
+	init_args(args);
+	while (i < argc) {
+		arg = argv[i];
+		dbg("arg %d %s\n", i, arg);
+		if (!strcmp(arg, "--")) {
+			++i;
+			break;
+		} else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+			print_help(argv[0]);
+			return 1;
+		} else if (!strcmp(arg, "-s") || !strcmp(arg, "--socket")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			args->socket = argv[i++];
+		} else if (!strcmp(arg, "-i") || !strcmp(arg, "--interval")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			if (parse_time(argv[i++], &args->interval)) {
+				return 1;
+			}
+		} else if (!strcmp(arg, "-t") || !strcmp(arg, "--timeout")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			if (parse_time(argv[i++], &args->timeout)) {
+				return 1;
+			}
+		} else if (!strcmp(arg, "-b") || !strcmp(arg, "--buf-size")) {
+			++i;
+			if (i >= argc) {
+				goto missing_arg;
+			}
+			arg = argv[i++];
+			int buf_size = atoi(arg);
+			if (buf_size <= 0) {
+				fprintf(
+					stderr,
+					"Buffer size must be greater than 0 (got %s)\n",
+					arg
+				);
+				return 1;
+			}
+			args->buf_size = buf_size;
+		} else {
+			int rc = parse_rt_arg(argc, argv, &i, &args->_rt);
+			if (rc < 0) {
+				return 1;
+			}
+			if (rc) {
+				break;
+			}
+			args->rt = 1;
+		}
+	}
+	if (argc == i || (argc - i) % 2) {
+		print_help(argv[0]);
+		return 1;
+	}
+	args->lines = argv + i;
+	args->size = (argc - i) / 2;
+	return 0;
+missing_arg:
+	fprintf(stderr, "Option %s requires an argument\n", arg);
+	return 1;
+}
+
+static int open_socket(const char *path) {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(fd, 16)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int open_timer(double interval) {
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	struct itimerspec its;
+	its.it_interval.tv_sec = interval;
+	its.it_interval.tv_nsec = (interval - its.it_interval.tv_sec) * 1e9;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int open_signals() {
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGHUP);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL)) {
+		return -1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	return signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+#define append(s, ...) do { \
+	if ((s)->snapshot_len < (s)->snapshot_size) { \
+		(s)->snapshot_len += snprintf( \
+			(s)->snapshot + (s)->snapshot_len, \
+			(s)->snapshot_size - (s)->snapshot_len, \
+			__VA_ARGS__ \
+		); \
+	} \
+} while (0)
+
+static const char *metric_names[][3] = {
+	{ "gpio_frequency_hertz", "gauge", "Input frequency." },
+	{ "gpio_frequency_period_seconds", "gauge", "Input period." },
+	{ "gpio_frequency_duty_cycle_ratio", "gauge", "Input duty cycle." },
+	{ "gpio_frequency_edges_total", "counter", "Edges received." },
+	{ "gpio_frequency_reads_total", "counter", "Event reads." },
+	{ "gpio_frequency_last_edge_age_seconds", "gauge", "Time since the last edge." },
+};
+
+static void append_value(server *s, double value) {
+	if (isinf(value)) {
+		append(s, value > 0 ? "+Inf\n" : "-Inf\n");
+	} else if (isnan(value)) {
+		append(s, "NaN\n");
+	} else {
+		append(s, "%.9g\n", value);
+	}
+}
+
+/*
+ * Rebuilds the snapshot. Lines without edges for longer than the
+ * timeout are reset so that the gap is not counted as a period.
+ */
+static void build_snapshot(server *s, const arguments *args) {
+	int64_t now = now_ns();
+	int64_t timeout = args->timeout * 1e9;
+	gpiod_frequency_counter_pool *pool = &s->pool;
+
+	for (size_t i = 0; i < pool->size; ++i) {
+		line_stats *st = &s->stats[i];
+		if (!st->stale && now - st->last_edge > timeout) {
+			gpiod_frequency_counter_pool_reset_line(pool, i);
+			st->stale = 1;
+		}
+	}
+
+	s->snapshot_len = 0;
+	for (size_t m = 0; m < sizeof(metric_names) / sizeof(*metric_names); ++m) {
+		append(
+			s,
+			"# HELP %s %s\n# TYPE %s %s\n",
+			metric_names[m][0],
+			metric_names[m][2],
+			metric_names[m][0],
+			metric_names[m][1]
+		);
+		for (size_t i = 0; i < pool->size; ++i) {
+			line_stats *st = &s->stats[i];
+			append(
+				s,
+				"%s{chip=\"%s\",line=\"%u\"} ",
+				metric_names[m][0],
+				gpiod_chip_name(gpiod_line_get_chip(pool->lines[i])),
+				gpiod_line_offset(pool->lines[i])
+			);
+			switch (m) {
+				case 0:
+					append_value(
+						s,
+						gpiod_frequency_counter_pool_get_frequency(pool, i)
+					);
+					break;
+				case 1:
+					append_value(
+						s,
+						gpiod_frequency_counter_pool_get_period(pool, i)
+					);
+					break;
+				case 2:
+					append_value(
+						s,
+						gpiod_frequency_counter_pool_get_duty_cycle(pool, i)
+					);
+					break;
+				case 3:
+					append(s, "%llu\n", (unsigned long long)st->edges);
+					break;
+				case 4:
+					append(s, "%llu\n", (unsigned long long)st->reads);
+					break;
+				case 5:
+					append_value(
+						s,
+						st->edges ? 1e-9 * (now - st->last_edge) : INFINITY
+					);
+					break;
+			}
+		}
+	}
+	append(
+		s,
+		"# HELP gpio_frequency_wakeups_total Capture loop wake-ups.\n"
+		"# TYPE gpio_frequency_wakeups_total counter\n"
+		"gpio_frequency_wakeups_total %llu\n"
+		"# HELP gpio_frequency_scrapes_total Snapshots served.\n"
+		"# TYPE gpio_frequency_scrapes_total counter\n"
+		"gpio_frequency_scrapes_total %llu\n"
+		"# HELP gpio_frequency_snapshots_total Snapshots built.\n"
+		"# TYPE gpio_frequency_snapshots_total counter\n"
+		"gpio_frequency_snapshots_total %llu\n"
+		"# HELP gpio_frequency_snapshot_build_seconds Time to build the previous snapshot.\n"
+		"# TYPE gpio_frequency_snapshot_build_seconds gauge\n"
+		"gpio_frequency_snapshot_build_seconds %.9f\n"
+		"# HELP gpio_frequency_uptime_seconds Time since start.\n"
+		"# TYPE gpio_frequency_uptime_seconds gauge\n"
+		"gpio_frequency_uptime_seconds %.3f\n",
+		(unsigned long long)s->wakeups,
+		(unsigned long long)s->scrapes,
+		(unsigned long long)++s->snapshots,
+		s->build_time,
+		1e-9 * (now - s->start)
+	);
+	if (s->snapshot_len >= s->snapshot_size) {
+		fprintf(stderr, "snapshot truncated\n");
+		s->snapshot_len = s->snapshot_size - 1;
+	}
+	s->build_time = 1e-9 * (now_ns() - now);
+}
+
+static void read_line(server *s, size_t index) {
+	struct gpiod_line_event events[EVENT_BATCH_SIZE];
+	int rc = gpiod_line_event_read_fd_multiple(
+		s->fds[FD_LINES + index].fd,
+		events,
+		EVENT_BATCH_SIZE
+	);
+	if (rc <= 0) {
+		if (rc < 0) {
+			fprintf(stderr, "gpiod_line_event_read_fd_multiple: %s\n", strerror(errno));
+			/* stays readable, so it is no longer polled */
+			s->fds[FD_LINES + index].fd = -1;
+		}
+		return;
+	}
+	line_stats *st = &s->stats[index];
+	gpiod_frequency_counter_pool_add_events(&s->pool, index, events, rc);
+	st->edges += rc;
+	++st->reads;
+	st->last_edge = now_ns();
+	st->stale = 0;
+}
+
+static void close_client(server *s, size_t k) {
+	close(s->client_fds[k].fd);
+	s->client_fds[k].fd = -1;
+	s->client_fds[k].events = 0;
+	free(s->clients[k].buf);
+	s->clients[k].buf = NULL;
+	/* a slot is free again */
+	s->fds[FD_SOCKET].events = POLLIN;
+}
+
+/*
+ * Sends as much of the snapshot as the socket takes and waits for
+ * POLLOUT to continue, so a slow reader never blocks capture.
+ */
+static void send_client(server *s, size_t k) {
+	client *c = &s->clients[k];
+	while (c->offset < c->len) {
+		ssize_t rc = send(
+			s->client_fds[k].fd,
+			c->buf + c->offset,
+			c->len - c->offset,
+			MSG_DONTWAIT | MSG_NOSIGNAL
+		);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				s->client_fds[k].events = POLLOUT;
+				return;
+			}
+			dbg("send: %s\n", strerror(errno));
+			close_client(s, k);
+			return;
+		}
+		c->offset += rc;
+	}
+	close_client(s, k);
+	++s->scrapes;
+}
+
+static void serve_clients(server *s, int fd) {
+	while (1) {
+		size_t k = 0;
+		while (k < MAX_CLIENTS && s->client_fds[k].fd >= 0) {
+			++k;
+		}
+		if (k == MAX_CLIENTS) {
+			/* leave the rest in the backlog until a slot is free */
+			s->fds[FD_SOCKET].events = 0;
+			return;
+		}
+		int fd_client = accept(fd, NULL, NULL);
+		if (fd_client < 0) {
+			return;
+		}
+		client *c = &s->clients[k];
+		c->buf = malloc(s->snapshot_len);
+		if (!c->buf) {
+			fprintf(stderr, "malloc: %s\n", strerror(errno));
+			close(fd_client);
+			continue;
+		}
+		memcpy(c->buf, s->snapshot, s->snapshot_len);
+		c->len = s->snapshot_len;
+		c->offset = 0;
+		c->start = now_ns();
+		s->client_fds[k].fd = fd_client;
+		send_client(s, k);
+	}
+}
+
+static void drop_slow_clients(server *s) {
+	int64_t now = now_ns();
+	for (size_t k = 0; k < MAX_CLIENTS; ++k) {
+		if (s->client_fds[k].fd >= 0
+		    && now - s->clients[k].start > CLIENT_TIMEOUT * 1e9) {
+			dbg("client %zu timed out\n", k);
+			close_client(s, k);
+		}
+	}
+}
+
+static int run(server *s, const arguments *args) {
+	int64_t timeout = args->timeout * 1e9;
+	for (size_t i = 0; i < s->pool.size; ++i) {
+		/* counts as stale until the first edge */
+		s->stats[i].last_edge = s->start - timeout - 1;
+		s->stats[i].stale = 1;
+	}
+	build_snapshot(s, args);
+	while (1) {
+		int rc = poll(s->fds, s->nfds, -1);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "poll: %s\n", strerror(errno));
+			return -1;
+		}
+		++s->wakeups;
+		for (size_t i = 0; i < s->pool.size; ++i) {
+			if (s->fds[FD_LINES + i].revents) {
+				read_line(s, i);
+			}
+		}
+		for (size_t k = 0; k < MAX_CLIENTS; ++k) {
+			if (s->client_fds[k].revents) {
+				send_client(s, k);
+			}
+		}
+		if (s->fds[FD_TIMER].revents) {
+			uint64_t expirations;
+			if (read(s->fds[FD_TIMER].fd, &expirations, sizeof(expirations)) > 0) {
+				build_snapshot(s, args);
+				drop_slow_clients(s);
+			}
+		}
+		if (s->fds[FD_SOCKET].revents) {
+			serve_clients(s, s->fds[FD_SOCKET].fd);
+		}
+		if (s->fds[FD_SIGNAL].revents) {
+			struct signalfd_siginfo info;
+			if (read(s->fds[FD_SIGNAL].fd, &info, sizeof(info)) > 0) {
+				dbg("signal %u\n", info.ssi_signo);
+				return 0;
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	struct arguments args;
+	struct gpiod_line **lines = NULL;
+	server s;
+	int rc = 1;
+
+	memset(&s, 0, sizeof(s));
+
+	if (parse_args(argc, argv, &args)) {
+		return 1;
+	}
+
+	s.chips = calloc(args.size, sizeof(*s.chips));
+	s.stats = calloc(args.size, sizeof(*s.stats));
+	s.fds = calloc(FD_LINES + args.size + MAX_CLIENTS, sizeof(*s.fds));
+	lines = calloc(args.size, sizeof(*lines));
+	s.snapshot_size = 2048 + args.size * 1024;
+	s.snapshot = malloc(s.snapshot_size);
+	if (!s.chips || !s.stats || !s.fds || !lines || !s.snapshot) {
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		goto end;
+	}
+	s.nfds = FD_LINES + args.size + MAX_CLIENTS;
+	s.client_fds = s.fds + FD_LINES + args.size;
+	for (size_t i = 0; i < s.nfds; ++i) {
+		s.fds[i].fd = -1;
+		s.fds[i].events = POLLIN | POLLPRI;
+	}
+	for (size_t k = 0; k < MAX_CLIENTS; ++k) {
+		s.client_fds[k].events = 0;
+	}
+
+	for (size_t i = 0; i < args.size; ++i) {
+		const char *chip = args.lines[2 * i];
+		unsigned long offset = strtoul(args.lines[2 * i + 1], NULL, 0);
+		/* lines on the same chip share one handle */
+		struct gpiod_chip *handle = NULL;
+		for (size_t j = 0; j < i && !handle; ++j) {
+			if (!strcmp(args.lines[2 * j], chip)) {
+				handle = gpiod_line_get_chip(lines[j]);
+			}
+		}
+		if (!handle) {
+			struct gpiod_chip *opened = gpiod_chip_open_lookup(chip);
+			if (!opened) {
+				fprintf(
+					stderr,
+					"gpiod_chip_open(%s): %s\n",
+					chip,
+					strerror(errno)
+				);
+				goto end;
+			}
+			/* the same chip given by name and by number */
+			for (size_t j = 0; j < s.chip_count && !handle; ++j) {
+				if (!strcmp(gpiod_chip_name(s.chips[j]), gpiod_chip_name(opened))) {
+					handle = s.chips[j];
+				}
+			}
+			if (handle) {
+				gpiod_chip_close(opened);
+			} else {
+				handle = opened;
+				s.chips[s.chip_count++] = opened;
+			}
+		}
+		if (!(lines[i] = gpiod_chip_get_line(handle, offset))) {
+			fprintf(
+				stderr,
+				"gpiod_chip_get_line(%s, %lu): %s\n",
+				chip,
+				offset,
+				strerror(errno)
+			);
+			goto end;
+		}
+	}
+
+	if (gpiod_frequency_counter_pool_init(
+		&s.pool,
+		lines,
+		args.size,
+		args.buf_size,
+		args.name,
+		0
+	)) {
+		fprintf(stderr, "gpiod_frequency_counter_pool_init: %s\n", strerror(errno));
+		goto end;
+	}
+	if (gpiod_frequency_counter_pool_request(&s.pool)) {
+		fprintf(stderr, "gpiod_frequency_counter_pool_request: %s\n", strerror(errno));
+		goto end;
+	}
+	for (size_t i = 0; i < args.size; ++i) {
+		s.fds[FD_LINES + i].fd = gpiod_line_event_get_fd(lines[i]);
+	}
+
+	if ((s.fds[FD_SIGNAL].fd = open_signals()) < 0) {
+		fprintf(stderr, "signalfd: %s\n", strerror(errno));
+		goto end;
+	}
+	if ((s.fds[FD_TIMER].fd = open_timer(args.interval)) < 0) {
+		fprintf(stderr, "timerfd: %s\n", strerror(errno));
+		goto end;
+	}
+	if ((s.fds[FD_SOCKET].fd = open_socket(args.socket)) < 0) {
+		fprintf(stderr, "socket(%s): %s\n", args.socket, strerror(errno));
+		goto end;
+	}
+	if (args.rt && gpiod_frequency_rt_apply(&args._rt)) {
+		fprintf(stderr, "gpiod_frequency_rt_apply: %s\n", strerror(errno));
+		goto end;
+	}
+
+	s.start = now_ns();
+	rc = run(&s, &args) ? 1 : 0;
+	unlink(args.socket);
+
+end:
+	if (s.fds) {
+		for (size_t i = 0; i < FD_LINES; ++i) {
+			if (s.fds[i].fd >= 0) {
+				close(s.fds[i].fd);
+			}
+		}
+		for (size_t k = 0; k < MAX_CLIENTS; ++k) {
+			if (s.client_fds && s.client_fds[k].fd >= 0) {
+				close_client(&s, k);
+			}
+		}
+	}
+	gpiod_frequency_counter_pool_destroy(&s.pool);
+	for (size_t i = 0; i < s.chip_count; ++i) {
+		gpiod_chip_close(s.chips[i]);
+	}
+	free(s.snapshot);
+	free(lines);
+	free(s.fds);
+	free(s.stats);
+	free(s.chips);
+	return rc;
+}
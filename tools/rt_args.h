@@ -0,0 +1,91 @@
+#ifndef RT_ARGS_H_INCLUDED
+#define RT_ARGS_H_INCLUDED
+
+#include <gpiod_frequency_rt.h>
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Real-time options shared by the tools.
+ */
+
+#define RT_ARGS_USAGE "[-r <priority>] [-c <cpu>] [-m]"
+
+#define RT_ARGS_HELP \
+	"    -r, --rt-priority <n>    capture with SCHED_FIFO priority n\n" \
+	"    -c, --cpu <n>            pin capture to cpu n\n" \
+	"    -m, --mlock              lock and pre-fault memory\n"
+
+/*
+ * Parses the real-time option at argv[*i] into rt and advances *i past
+ * it. Returns 1 if argv[*i] is not a real-time option, -1 after printing
+ * an error and 0 otherwise.
+ */
+static inline int parse_rt_arg(
+	int argc,
+	char **argv,
+	int *i,
+	gpiod_frequency_rt *rt
+) {
+	const char *opt = argv[*i];
+	const char *arg;
+	if (!strcmp(opt, "-r") || !strcmp(opt, "--rt-priority")) {
+		if (++*i >= argc) {
+			goto missing_arg;
+		}
+		arg = argv[(*i)++];
+		int priority = atoi(arg);
+		int min = sched_get_priority_min(SCHED_FIFO);
+		int max = sched_get_priority_max(SCHED_FIFO);
+		if (priority < min || priority > max) {
+			fprintf(
+				stderr,
+				"Priority must be between %d and %d (got %s)\n",
+				min,
+				max,
+				arg
+			);
+			return -1;
+		}
+		rt->policy = SCHED_FIFO;
+		rt->priority = priority;
+	} else if (!strcmp(opt, "-c") || !strcmp(opt, "--cpu")) {
+		if (++*i >= argc) {
+			goto missing_arg;
+		}
+		arg = argv[(*i)++];
+		char *end;
+		long cpu = strtol(arg, &end, 0);
+		if (*end || cpu < 0) {
+			fprintf(stderr, "Invalid cpu number: %s\n", arg);
+			return -1;
+		}
+		long cpus = sysconf(_SC_NPROCESSORS_CONF);
+		if (cpu >= cpus) {
+			fprintf(
+				stderr,
+				"Cpu must be between 0 and %ld (got %s)\n",
+				cpus - 1,
+				arg
+			);
+			return -1;
+		}
+		rt->cpu = cpu;
+	} else if (!strcmp(opt, "-m") || !strcmp(opt, "--mlock")) {
+		++*i;
+		rt->lock_memory = 1;
+		rt->prefault_stack = 64 * 1024;
+	} else {
+		return 1;
+	}
+	return 0;
+missing_arg:
+	fprintf(stderr, "Option %s requires an argument\n", opt);
+	return -1;
+}
+
+#endif